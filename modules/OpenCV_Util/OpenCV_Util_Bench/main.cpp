@@ -0,0 +1,278 @@
+/**
+ * @file main.cpp
+ * @brief OpenCV_Util阈值算法基准，对比旧的OpenMP标量实现、当前实现、HSVThreshold与cv::inRange，
+ *        BGR到HSV融合阈值与分步实现，多范围查找表与逐范围实现，批量三维旋转与逐点旋转，平面PnP快速解法与迭代解法，
+ *        位姿滤波的耗时与精度，以及批量最近点查找
+ */
+
+#include <OpenCV_Util.h>
+#include <HSVThreshold.h>
+#include <PNP_Calculate.h>
+#include <PoseFilter.h>
+#include <spdlog/spdlog.h>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+/**
+ * 原有的标量实现，作为对照
+ */
+static void LegacyHChannleOffsetInRange(const cv::Mat &Input, int offset, const cv::Scalar &lowerb,
+                                        const cv::Scalar &upperb, cv::Mat &dst) {
+    int nr = Input.rows;
+    int chs = Input.channels();
+    int nl = Input.cols * chs;
+    dst.create(Input.rows, Input.cols, CV_8U);
+
+    int16_t H_Upper = (int16_t) upperb[0] + offset, H_Lower = (int16_t) lowerb[0] + offset;
+    int16_t S_Upper = (int16_t) upperb[1], S_Lower = (int16_t) lowerb[1];
+    int16_t V_Upper = (int16_t) upperb[2], V_Lower = (int16_t) lowerb[2];
+#pragma omp parallel for
+    for (int k = 0; k < nr; k++) {
+        const uchar *inData = Input.ptr<uchar>(k);
+        uchar *outData = dst.ptr<uchar>(k);
+#pragma omp parallel for
+        for (int i = 0; i < nl; i += 3) {
+            int16_t H = ((int16_t) inData[i] + offset) % 180;
+            uint8_t S = inData[i + 1];
+            uint8_t V = inData[i + 2];
+            outData[i / 3] = (H_Lower <= H && H <= H_Upper &&
+                              S_Lower <= S && S <= S_Upper &&
+                              V_Lower <= V && V <= V_Upper) ? 0xff : 0x00;
+        }
+    }
+}
+
+/**
+ * 运行一项测试
+ * @param name 名称
+ * @param iterations 迭代次数
+ * @param fun 被测函数
+ * @return 单次平均毫秒数
+ */
+static double measure(const char *name, int iterations, const std::function<void()> &fun) {
+    fun();
+    cv::TickMeter tm;
+    tm.start();
+    for (int i = 0; i < iterations; i++)
+        fun();
+    tm.stop();
+    double ms = tm.getTimeMilli() / iterations;
+    spdlog::info("  {:<24} {:8.3f} ms", name, ms);
+    return ms;
+}
+
+/**
+ * 合成投影上对比PnP解法的速度和精度
+ * @param iterations 迭代次数
+ * @param rng 随机数发生器
+ */
+static void benchmarkPnP(int iterations, cv::RNG &rng) {
+    /* 1280x720相机，桶形畸变，写入临时标定文件 */
+    const cv::Matx33d K(1000, 0, 640,
+                        0, 1000, 360,
+                        0, 0, 1);
+    const cv::Vec<double, 5> D(-0.12, 0.08, 0.001, -0.0005, 0);
+    const std::string path = cv::tempfile(".xml");
+    {
+        cv::FileStorage fs(path, cv::FileStorage::WRITE);
+        fs << "camera-matrix" << cv::Mat(K) << "distortion" << cv::Mat(D);
+    }
+    const double sizes[][2] = {{55, 135}, {125, 125}};  // 装甲板与正方形，毫米
+    const int targets = 1000;
+    for (const auto &size : sizes) {
+        PNP_Calculate pnp(path);
+        pnp.SetTargetSize(size[0], size[1]);
+        const int fast = pnp.GetPnPMethod();
+
+        /* 随机位姿投影，加0.3像素噪声 */
+        std::vector<cv::Point3f> object = {{(float) -size[1] / 2, (float) -size[0] / 2, 0},
+                                           {(float) size[1] / 2, (float) -size[0] / 2, 0},
+                                           {(float) size[1] / 2, (float) size[0] / 2, 0},
+                                           {(float) -size[1] / 2, (float) size[0] / 2, 0}};
+        std::vector<std::vector<cv::Point2f>> quads(targets);
+        std::vector<cv::Vec3d> truth(targets);
+        for (int i = 0; i < targets; i++) {
+            cv::Vec3d rvec(rng.uniform(-0.6, 0.6), rng.uniform(-0.6, 0.6), rng.uniform(-0.15, 0.15));
+            truth[i] = cv::Vec3d(rng.uniform(-800.0, 800.0), rng.uniform(-400.0, 400.0), rng.uniform(1000.0, 6000.0));
+            cv::projectPoints(object, rvec, truth[i], K, D, quads[i]);
+            for (cv::Point2f &p : quads[i])
+                p += cv::Point2f((float) rng.gaussian(0.3), (float) rng.gaussian(0.3));
+        }
+
+        spdlog::info("PnP {}x{} target, {} poses:", size[1], size[0], targets);
+        std::vector<PNP_Calculate::Solution> solutions;
+        SpatialLocation location;
+        struct {
+            const char *name;
+            int method;
+            bool cache;
+        } const methods[] = {{"SOLVEPNP_ITERATIVE", cv::SOLVEPNP_ITERATIVE, false},
+                             {"fast path", fast, false},
+                             {"fast path + undistort", fast, true}};
+        for (const auto &method : methods) {
+            pnp.SetPnPMethod(method.method);
+            if (method.cache)
+                pnp.EnableUndistortCache(cv::Size(1280, 720));
+            else
+                pnp.DisableUndistortCache();
+            double ms = measure(method.name, std::max(1, iterations / 20), [&]() {
+                for (const auto &quad : quads)
+                    pnp.GetSpatialLocation(location, quad);
+            });
+            pnp.GetSpatialLocations(quads, solutions);
+            double error = 0;
+            int valid = 0;
+            for (int i = 0; i < targets; i++) {
+                if (!solutions[i].valid)
+                    continue;
+                error += cv::norm(solutions[i].tvec - truth[i]) / truth[i][2];
+                valid++;
+            }
+            spdlog::info("  {:.1f} us per target, mean translation error {:.3f}% of distance, {} solved",
+                         ms * 1000 / targets, 100 * error / std::max(1, valid), valid);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * 100Hz合成轨迹上测量位姿滤波每次更新的耗时，以及滤波、预测50ms后的误差
+ * @param rng 随机数发生器
+ */
+static void benchmarkPoseFilter(cv::RNG &rng) {
+    const int updates = 100000;
+    const double latency = 0.05;
+    const std::pair<const char *, PoseFilter::Model> models[] = {
+            {"constant velocity", PoseFilter::CONSTANT_VELOCITY},
+            {"constant acceleration", PoseFilter::CONSTANT_ACCELERATION}};
+    spdlog::info("PoseFilter {} updates at 100Hz, 10mm/2deg noise:", updates);
+    for (const auto &model : models) {
+        PoseFilter filter(model.second);
+        double raw = 0, filtered = 0, predicted = 0, seconds = 0;
+        for (int k = 0; k < updates; k++) {
+            double t = k * 0.01;
+            double x = 1000 * sin(t * 0.5), future = 1000 * sin((t + latency) * 0.5);
+            SpatialLocation measurement((float) (x + rng.gaussian(10)), (float) rng.gaussian(10),
+                                        (float) (3000 + rng.gaussian(10)), (float) rng.gaussian(2),
+                                        (float) (20 * sin(t) + rng.gaussian(2)), (float) rng.gaussian(2));
+            int64 begin = cv::getTickCount();
+            SpatialLocation output = filter.update(measurement, t);
+            SpatialLocation prediction = filter.predict(t + latency);
+            seconds += (cv::getTickCount() - begin) / cv::getTickFrequency();
+            raw += (measurement.x - x) * (measurement.x - x);
+            filtered += (output.x - x) * (output.x - x);
+            predicted += (prediction.x - future) * (prediction.x - future);
+        }
+        spdlog::info("  {:<24} {:.3f} us per update + predict, x rms error raw {:.2f}, filtered {:.2f}, "
+                     "predicted {:.0f}ms ahead {:.2f}", model.first, seconds * 1e6 / updates,
+                     sqrt(raw / updates), sqrt(filtered / updates), latency * 1000, sqrt(predicted / updates));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+    spdlog::info("{} iterations, {} threads, SIMD: {}", iterations, cv::getNumThreads(),
+                 cv::checkHardwareSupport(CV_CPU_AVX2) ? "AVX2" : "baseline");
+
+    /* 红色在0附近，偏置后变为连续区间 */
+    const int offset = 20;
+    const cv::Scalar lowerb(10, 43, 46), upperb(40, 255, 255);
+    const cv::Size sizes[] = {{640, 480}, {1280, 720}, {1920, 1080}};
+    const HSVThreshold threshold(offset, lowerb, upperb);
+    cv::RNG rng(0x5a);
+    for (const cv::Size &size : sizes) {
+        cv::Mat hsv(size, CV_8UC3), legacy, mask, lut, ref;
+        rng.fill(hsv, cv::RNG::UNIFORM, cv::Scalar(0, 0, 0), cv::Scalar(180, 256, 256));
+        spdlog::info("{}x{}:", size.width, size.height);
+        double base = measure("legacy (OpenMP)", iterations, [&]() {
+            LegacyHChannleOffsetInRange(hsv, offset, lowerb, upperb, legacy);
+        });
+        double ms = measure("HChannleOffsetInRange", iterations, [&]() {
+            HChannleOffsetInRange(hsv, offset, lowerb, upperb, mask);
+        });
+        double thresholdMs = measure("HSVThreshold", iterations, [&]() {
+            threshold.apply(hsv, lut);
+        });
+        measure("cv::inRange (no offset)", iterations, [&]() {
+            cv::inRange(hsv, lowerb, upperb, ref);
+        });
+        spdlog::info("  speedup {:.2f}x, mismatch {} pixels", base / ms, cv::countNonZero(legacy != mask));
+        spdlog::info("  HSVThreshold speedup {:.2f}x, mismatch {} pixels", base / thresholdMs,
+                     cv::countNonZero(legacy != lut));
+    }
+
+    /* 红色的两个色调区间 */
+    const std::vector<HSVRange> red = {{0, cv::Scalar(0, 43, 46), cv::Scalar(10, 255, 255)},
+                                       {0, cv::Scalar(156, 43, 46), cv::Scalar(180, 255, 255)}};
+    for (const cv::Size &size : sizes) {
+        cv::Mat bgr(size, CV_8UC3), hsv, mask0, mask1, split, fused;
+        rng.fill(bgr, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+        spdlog::info("{}x{} BGR, two ranges:", size.width, size.height);
+        double base = measure("cvtColor + 2x InRange", iterations, [&]() {
+            cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+            HChannleOffsetInRange(hsv, red[0].offset, red[0].lowerb, red[0].upperb, mask0);
+            HChannleOffsetInRange(hsv, red[1].offset, red[1].lowerb, red[1].upperb, mask1);
+            cv::bitwise_or(mask0, mask1, split);
+        });
+        double ms = measure("BGR2HSVOffsetInRange", iterations, [&]() {
+            BGR2HSVOffsetInRange(bgr, red, fused);
+        });
+        spdlog::info("  speedup {:.2f}x, mismatch {} pixels", base / ms, cv::countNonZero(split != fused));
+        /* 已有HSV图像时对比查找表与逐范围向量化 */
+        const HSVThreshold redThreshold(red);
+        cv::Mat lut;
+        base = measure("2x InRange on HSV", iterations, [&]() {
+            HChannleOffsetInRange(hsv, red[0].offset, red[0].lowerb, red[0].upperb, mask0);
+            HChannleOffsetInRange(hsv, red[1].offset, red[1].lowerb, red[1].upperb, mask1);
+            cv::bitwise_or(mask0, mask1, split);
+        });
+        ms = measure("HSVThreshold (LUT)", iterations, [&]() {
+            redThreshold.apply(hsv, lut);
+        });
+        spdlog::info("  LUT speedup {:.2f}x, mismatch {} pixels", base / ms, cv::countNonZero(split != lut));
+    }
+    /* 640x480点云旋转到云台坐标系 */
+    std::vector<cv::Point3f> cloud(640 * 480), rotated(cloud.size());
+    rng.fill(cv::Mat(cloud).reshape(1), cv::RNG::UNIFORM, -5, 5);
+    spdlog::info("{} points rotation:", cloud.size());
+    double base = measure("Rotation3D per point", iterations, [&]() {
+        for (size_t i = 0; i < cloud.size(); i++)
+            rotated[i] = Rotation3D(cloud[i], "ZYX", 0.1f, 0.2f, 0.3f);
+    });
+    double ms = measure("Rotation3D batch", iterations, [&]() {
+        Rotation3D(cloud.data(), rotated.data(), cloud.size(), "ZYX", 0.1f, 0.2f, 0.3f);
+    });
+    spdlog::info("  speedup {:.2f}x", base / ms);
+
+    /* 帧间目标匹配，每个查询点在64个候选点中找最近点 */
+    std::vector<cv::Point2f> queries(1024), candidates(64);
+    rng.fill(cv::Mat(queries).reshape(1), cv::RNG::UNIFORM, 0, 1280);
+    rng.fill(cv::Mat(candidates).reshape(1), cv::RNG::UNIFORM, 0, 1280);
+    std::vector<int> loopResult(queries.size()), batchResult(queries.size());
+    spdlog::info("{} queries x {} candidates nearest point:", queries.size(), candidates.size());
+    base = measure("distenceP2P loop", iterations, [&]() {
+        for (size_t i = 0; i < queries.size(); i++) {
+            float best = std::numeric_limits<float>::max();
+            for (size_t j = 0; j < candidates.size(); j++) {
+                float d = distenceP2P(queries[i], candidates[j]);
+                if (d < best) {
+                    best = d;
+                    loopResult[i] = (int) j;
+                }
+            }
+        }
+    });
+    ms = measure("nearestPoint", iterations, [&]() {
+        for (size_t i = 0; i < queries.size(); i++)
+            batchResult[i] = nearestPoint(queries[i], candidates.data(), candidates.size());
+    });
+    spdlog::info("  speedup {:.2f}x, {} different", base / ms,
+                 queries.size() - std::inner_product(loopResult.begin(), loopResult.end(), batchResult.begin(),
+                                                     (size_t) 0, std::plus<size_t>(), std::equal_to<int>()));
+
+    benchmarkPnP(iterations, rng);
+    benchmarkPoseFilter(rng);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file HSVThreshold.h
+ * @brief 可复用阈值参数的带偏置HSV阈值
+ */
+
+#ifndef KDROBOTCPPLIBS_HSVTHRESHOLD_H
+#define KDROBOTCPPLIBS_HSVTHRESHOLD_H
+
+#include <vector>
+#include <stdint.h>
+#include "OpenCV_Util.h"
+
+/**
+ * @brief 可复用阈值参数的带偏置HSV阈值
+ * @details 单个范围时直接使用HChannleOffsetInRange的向量化实现，每次处理一整个向量寄存器的像素，
+ *          比逐像素查表快。
+ *          多个范围时使用查找表：H、S、V三个判断各自只和一个通道有关，阈值不变时预先算出三张256项的表，
+ *          表项的第j位表示是否满足第j个范围，最多MAX_RANGES个范围，每个像素只需三次查表和按位与，
+ *          图像只遍历一次；逐范围向量化判断再按位或需要遍历多次，范围越多查找表越有优势，
+ *          两个范围以上、或者没有SIMD的平台上适合使用本类。
+ *          结果与HChannleOffsetInRange(多个范围时为按位或)相同；
+ *          set在参数与当前相同时不重建查找表，可以在调参界面每帧调用
+ * @warning set与apply不能在不同线程同时调用
+ * @class HSVThreshold
+ */
+class HSVThreshold {
+    std::vector<HSVRange> ranges;
+    uint8_t H_LUT[256];
+    uint8_t S_LUT[256];
+    uint8_t V_LUT[256];
+
+    /**
+     * @brief 按当前范围重建查找表
+     */
+    void build();
+
+public:
+    static const size_t MAX_RANGES = 8;    //!<@brief 最多范围个数
+
+    /**
+     * @brief 构造函数，没有范围，所有像素都不通过
+     */
+    HSVThreshold();
+
+    /**
+     * @brief 构造函数，单个范围
+     * @param offset 通道一偏置
+     * @param lowerb 下限
+     * @param upperb 上限
+     */
+    HSVThreshold(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb);
+
+    /**
+     * @brief 构造函数，多个范围
+     * @param ranges 阈值范围，满足任意一个即通过
+     */
+    explicit HSVThreshold(const std::vector<HSVRange> &ranges);
+
+    /**
+     * @brief 设置阈值，单个范围
+     * @param offset 通道一偏置
+     * @param lowerb 下限
+     * @param upperb 上限
+     * @return 参数有变化、重建了查找表时返回true
+     */
+    bool set(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb);
+
+    /**
+     * @brief 设置阈值，多个范围
+     * @param ranges 阈值范围，满足任意一个即通过
+     * @return 参数有变化、重建了查找表时返回true
+     * @throw std::invalid_argument 范围个数超过MAX_RANGES
+     */
+    bool set(const std::vector<HSVRange> &ranges);
+
+    /**
+     * @brief 当前阈值范围
+     */
+    inline const std::vector<HSVRange> &getRanges() const {
+        return ranges;
+    }
+
+    /**
+     * @brief 阈值化，cv::parallel_for_按行条带并行，单个范围时使用向量化实现，多个范围时查表
+     * @param Input 输入HSV图像，CV_8U，至少3通道，只使用前3个通道
+     * @param dst 输出图像
+     */
+    void apply(const cv::Mat &Input, cv::Mat &dst) const;
+};
+
+#endif
@@ -20,11 +20,13 @@
  */
 template<typename T>
 inline T distenceP2P(const cv::Point_<T> &a, const cv::Point_<T> &b = {0, 0}) {
-    return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2));
+    T dx = a.x - b.x, dy = a.y - b.y;
+    return std::sqrt(dx * dx + dy * dy);
 }
 
 /**
  * 点到线距离
+ * @note 由叉积计算，竖直线也适用；A、B重合时为点到A的距离
  * @tparam T 点数据类型
  * @param p 点
  * @param a 线端点A
@@ -33,8 +35,12 @@ inline T distenceP2P(const cv::Point_<T> &a, const cv::Point_<T> &b = {0, 0}) {
  */
 template<typename T>
 inline T distenceP2L(const cv::Point_<T> &p, const cv::Point_<T> &a, const cv::Point_<T> &b) {
-    T l = (b.y - a.y) / (b.x - a.x);
-    return fabs(l * p.x - p.y + a.y - l * a.x) / sqrt(l * l + 1);
+    double dx = (double) b.x - a.x, dy = (double) b.y - a.y;
+    double px = (double) p.x - a.x, py = (double) p.y - a.y;
+    double len = std::hypot(dx, dy);
+    if (len == 0)
+        return std::hypot(px, py);
+    return std::fabs(dx * py - dy * px) / len;
 }
 
 /**
@@ -46,9 +52,68 @@ inline T distenceP2L(const cv::Point_<T> &p, const cv::Point_<T> &a, const cv::P
  */
 template<typename T>
 inline T distence3P2P(const cv::Point3_<T> &a, const cv::Point3_<T> &b = {0, 0, 0}) {
-    return std::sqrt(std::pow(a.x - b.x, 2) + std::pow(a.y - b.y, 2) + std::pow(a.z - b.z, 2));
+    T dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
 }
 
+/**
+ * 批量点到点距离，逐对计算，使用OpenCV通用SIMD指令
+ * @param a 点集A
+ * @param b 点集B
+ * @param dst 输出，dst[i]为a[i]到b[i]的距离
+ * @param count 点数
+ * @param squared 为true时输出距离的平方，不开方，只比较远近时使用
+ */
+void distenceP2P(const cv::Point2f *a, const cv::Point2f *b, float *dst, size_t count, bool squared = false);
+
+/**
+ * 批量点到点距离，一点到多点，使用OpenCV通用SIMD指令
+ * @param p 点
+ * @param points 点集
+ * @param dst 输出，dst[i]为p到points[i]的距离
+ * @param count 点数
+ * @param squared 为true时输出距离的平方，不开方
+ */
+void distenceP2P(const cv::Point2f &p, const cv::Point2f *points, float *dst, size_t count, bool squared = false);
+
+/**
+ * 批量三维点到点距离，逐对计算，使用OpenCV通用SIMD指令
+ * @see distenceP2P(const cv::Point2f *, const cv::Point2f *, float *, size_t, bool)
+ */
+void distence3P2P(const cv::Point3f *a, const cv::Point3f *b, float *dst, size_t count, bool squared = false);
+
+/**
+ * 批量三维点到点距离，一点到多点，使用OpenCV通用SIMD指令
+ * @see distenceP2P(const cv::Point2f &, const cv::Point2f *, float *, size_t, bool)
+ */
+void distence3P2P(const cv::Point3f &p, const cv::Point3f *points, float *dst, size_t count, bool squared = false);
+
+/**
+ * 点集中离某点最近的点，比较距离平方，不开方
+ * @param p 点
+ * @param points 点集
+ * @param count 点数
+ * @param distance 不为空时输出最近距离
+ * @return 最近点下标，距离相同时取下标小的；点集为空时返回-1
+ */
+int nearestPoint(const cv::Point2f &p, const cv::Point2f *points, size_t count, float *distance = nullptr);
+
+/**
+ * 三维点集中离某点最近的点
+ * @see nearestPoint(const cv::Point2f &, const cv::Point2f *, size_t, float *)
+ */
+int nearestPoint(const cv::Point3f &p, const cv::Point3f *points, size_t count, float *distance = nullptr);
+
+/**
+ * 两个点集间的距离矩阵，用于帧间目标匹配
+ * @param a 点集A
+ * @param b 点集B
+ * @param dst 输出，a.size()行b.size()列的CV_32F，dst(i, j)为a[i]到b[j]的距离
+ * @param squared 为true时输出距离的平方，不开方
+ */
+void distenceMatrix(const std::vector<cv::Point2f> &a, const std::vector<cv::Point2f> &b, cv::Mat &dst,
+                    bool squared = false);
+
 /**
  * 线角度
  * @tparam T 点数据类型
@@ -117,9 +182,105 @@ cv::Point3f Rotation3D_Z(const cv::Point3f &point, float z);
 cv::Point3f Rotation3D(const cv::Point3f &point, const char *order, float v1, float v2 = 0, float v3 = 0);
 
 /**
- * 通道一带有偏置的InRange，带有OpenMP多线程加速
+ * @brief 预先计算的三维空间旋转
+ * @details 构造时按旋转顺序把各轴旋转矩阵合成一个3x3矩阵，之后每个点只需一次矩阵乘法；
+ *          批量旋转使用OpenCV通用SIMD指令，点数较多时用cv::parallel_for_分块并行。
+ *          与Rotation3D的差别只在浮点舍入，合成矩阵以双精度计算
+ * @see Rotation3D
+ * @class Rotation3DMatrix
+ */
+class Rotation3DMatrix {
+    cv::Matx33f R;
+
+public:
+    /**
+     * @brief 构造函数，不旋转
+     */
+    Rotation3DMatrix();
+
+    /**
+     * @brief 构造函数
+     * @param order 字符串表示的旋转顺序，与Rotation3D相同
+     * @param v1 第一个角度
+     * @param v2 第二个角度
+     * @param v3 第三个角度
+     * @throw std::invalid_argument 顺序字符串错误
+     */
+    Rotation3DMatrix(const char *order, float v1, float v2 = 0, float v3 = 0);
+
+    /**
+     * @brief 合成的旋转矩阵，旋转后点为 R * point
+     */
+    inline const cv::Matx33f &matrix() const {
+        return R;
+    }
+
+    /**
+     * @brief 旋转单个点
+     * @param point 三维点
+     * @return 旋转后三维点
+     */
+    inline cv::Point3f operator()(const cv::Point3f &point) const {
+        return {R(0, 0) * point.x + R(0, 1) * point.y + R(0, 2) * point.z,
+                R(1, 0) * point.x + R(1, 1) * point.y + R(1, 2) * point.z,
+                R(2, 0) * point.x + R(2, 1) * point.y + R(2, 2) * point.z};
+    }
+
+    /**
+     * @brief 批量旋转
+     * @param src 输入点，连续存放的x、y、z，如rs2::points::get_vertices()
+     * @param dst 输出点，可以与src相同
+     * @param count 点数
+     */
+    void apply(const cv::Point3f *src, cv::Point3f *dst, size_t count) const;
+
+    /**
+     * @brief 批量旋转
+     * @param src 输入点
+     * @param dst 输出点，可以与src相同
+     */
+    void apply(const std::vector<cv::Point3f> &src, std::vector<cv::Point3f> &dst) const;
+
+    /**
+     * @brief 批量旋转
+     * @param src 输入点，CV_32FC3或Nx3的CV_32FC1
+     * @param dst 输出点，与src尺寸和类型相同，可以与src相同
+     */
+    void apply(const cv::Mat &src, cv::Mat &dst) const;
+};
+
+/**
+ * 基于旋转矩阵的批量三维空间旋转，旋转矩阵只计算一次
+ * @see Rotation3DMatrix
+ * @param src 输入点，连续存放的x、y、z
+ * @param dst 输出点，可以与src相同
+ * @param count 点数
+ * @param order 字符串表示的旋转顺序，与Rotation3D相同
+ * @param v1 第一个角度
+ * @param v2 第二个角度
+ * @param v3 第三个角度
+ */
+void Rotation3D(const cv::Point3f *src, cv::Point3f *dst, size_t count,
+                const char *order, float v1, float v2 = 0, float v3 = 0);
+
+/**
+ * 基于旋转矩阵的批量三维空间旋转，旋转矩阵只计算一次
+ * @see Rotation3DMatrix
+ * @param src 输入点，CV_32FC3或Nx3的CV_32FC1
+ * @param dst 输出点，与src尺寸和类型相同，可以与src相同
+ * @param order 字符串表示的旋转顺序，与Rotation3D相同
+ * @param v1 第一个角度
+ * @param v2 第二个角度
+ * @param v3 第三个角度
+ */
+void Rotation3D(const cv::Mat &src, cv::Mat &dst, const char *order, float v1, float v2 = 0, float v3 = 0);
+
+/**
+ * 通道一带有偏置的InRange，使用OpenCV通用SIMD指令逐行向量化，cv::parallel_for_按行条带并行
  * @note 针对解决HSV颜色空间中红色在0附近不好判断的问题，HSV的H通道范围[0-180)
- * @param Input 输入图像
+ * @note 判定条件为 lowerb[0]+offset <= (H+offset)%180 <= upperb[0]+offset，%为C++截断取余；
+ *       偏置超出[-180, 180]或通道数不为3、4时使用标量代码，结果相同
+ * @param Input 输入图像，CV_8U，至少3通道，只使用前3个通道
  * @param offset 通道一偏置
  * @param lowerb 下限
  * @param upperb 上线
@@ -128,6 +289,47 @@ cv::Point3f Rotation3D(const cv::Point3f &point, const char *order, float v1, fl
 void HChannleOffsetInRange(const cv::Mat &Input, int offset, const cv::Scalar &lowerb,
                            const cv::Scalar &upperb, cv::Mat &dst);
 
+/**
+ * @brief 带有通道一偏置的HSV阈值范围
+ * @see HChannleOffsetInRange
+ */
+struct HSVRange {
+    int offset;         //!<@brief 通道一偏置
+    cv::Scalar lowerb;  //!<@brief 下限
+    cv::Scalar upperb;  //!<@brief 上限
+};
+
+inline bool operator==(const HSVRange &a, const HSVRange &b) {
+    return a.offset == b.offset && a.lowerb == b.lowerb && a.upperb == b.upperb;
+}
+
+inline bool operator!=(const HSVRange &a, const HSVRange &b) {
+    return !(a == b);
+}
+
+/**
+ * BGR图像直接转为带有偏置的HSV阈值二值图，等价于cv::cvtColor(COLOR_BGR2HSV)后对每个范围
+ * 调用HChannleOffsetInRange再按位或
+ * @note 按行条带并行，每个条带把少量行转换到留在缓存中的HSV块后立即阈值化，
+ *       不产生整幅HSV临时图像，内存读写约为分步实现的一半
+ * @param Input 输入图像，CV_8UC3的BGR或CV_8UC4的BGRA
+ * @param ranges 阈值范围，满足任意一个即通过，如红色的两个色调区间
+ * @param dst 输出图像
+ */
+void BGR2HSVOffsetInRange(const cv::Mat &Input, const std::vector<HSVRange> &ranges, cv::Mat &dst);
+
+/**
+ * BGR图像直接转为带有偏置的HSV阈值二值图，单个范围
+ * @see BGR2HSVOffsetInRange(const cv::Mat &, const std::vector<HSVRange> &, cv::Mat &)
+ * @param Input 输入图像，CV_8UC3的BGR或CV_8UC4的BGRA
+ * @param offset 通道一偏置
+ * @param lowerb 下限
+ * @param upperb 上限
+ * @param dst 输出图像
+ */
+void BGR2HSVOffsetInRange(const cv::Mat &Input, int offset, const cv::Scalar &lowerb,
+                          const cv::Scalar &upperb, cv::Mat &dst);
+
 template<class _Traits, class T>
 inline std::basic_ostream<char, _Traits> &
 operator<<(std::basic_ostream<char, _Traits> &os, const cv::Point_<T> &c) {
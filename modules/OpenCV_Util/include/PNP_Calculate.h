@@ -17,6 +17,16 @@
 class PNP_Calculate {
 public:
 
+    /**
+    * @brief  批量解算中单个目标的结果
+    */
+    struct Solution {
+        cv::Vec3d rvec;             //!<@brief 旋转向量
+        cv::Vec3d tvec;             //!<@brief 平移向量
+        SpatialLocation location;   //!<@brief 目标空间位置
+        bool valid = false;         //!<@brief 是否解算成功
+    };
+
     /**
     * @brief  单目测距类拷贝构造函数
     */
@@ -42,11 +52,52 @@ public:
 
     /**
     * @brief  设置目标大小，单位由标定时设置决定
+    * @note   目标为平面矩形，同时选择平面PnP快速解法：正方形用SOLVEPNP_IPPE_SQUARE，
+    *         其他矩形用SOLVEPNP_IPPE；OpenCV低于4.1时仍为SOLVEPNP_ITERATIVE
     * @param  目标高度
     * @param  目标宽度
     */
     void SetTargetSize(double height, double width);
 
+    /**
+    * @brief  指定PnP解法，覆盖SetTargetSize自动选择的解法，如对比精度时设为cv::SOLVEPNP_ITERATIVE
+    * @note   批量解算使用useExtrinsicGuess初值时总是使用SOLVEPNP_ITERATIVE
+    * @param  cv::SolvePnPMethod
+    */
+    inline void SetPnPMethod(int method) {
+        PnPMethod = method;
+    }
+
+    /**
+    * @brief  当前PnP解法
+    * @retval cv::SolvePnPMethod
+    */
+    inline int GetPnPMethod() const {
+        return PnPMethod;
+    }
+
+    /**
+    * @brief  启用去畸变查找表
+    * @note   预先对整幅图像的网格点去畸变，解算时角点按查找表双线性插值去畸变，再以零畸变调用solvePnP，
+    *         省去solvePnP内部对每个目标的迭代去畸变；Init重新读取标定参数后自动重建。
+    *         网格外的角点(如ROI偏移后超出图像)仍由solvePnP去畸变
+    * @param  图像尺寸
+    * @param  网格间距，像素；畸变变化平缓，插值误差远小于角点检测误差
+    */
+    void EnableUndistortCache(const cv::Size &imageSize, int gridStep = 4);
+
+    /**
+    * @brief  停用去畸变查找表
+    */
+    void DisableUndistortCache();
+
+    /**
+    * @brief  是否启用了去畸变查找表
+    */
+    inline bool IsUndistortCacheEnabled() const {
+        return !UndistortMap.empty();
+    }
+
     /**
     * @brief  得到目标空间位置
     * @param  目标空间位置输出引用
@@ -54,7 +105,7 @@ public:
     * @param  如果设置ROI,ROI的偏移量
     * @retval status
     */
-    bool GetSpatialLocation(SpatialLocation &Output, std::vector<cv::Point2f> Points2D,
+    bool GetSpatialLocation(SpatialLocation &Output, const std::vector<cv::Point2f> &Points2D,
                             const cv::Point2f &offset = cv::Point2f(0, 0));
 
     /**
@@ -74,7 +125,50 @@ public:
     */
     SpatialLocation GetSpatialLocation(void);
 
+    /**
+    * @brief  批量得到一帧中多个目标的空间位置，cv::parallel_for_在多核上并行解算
+    * @note   不修改GetSpatialLocation(void)返回的结果，可以在多个线程同时调用
+    * @param  每个目标在画面中的四边形2D点集，点数不足4个的目标解算失败
+    * @param  解算结果，调整为与目标个数相同；重复使用同一个向量可以避免每帧分配内存
+    * @param  为true时，对Solutions中同一下标、上一次解算成功的目标以其rvec、tvec为初值迭代求解(useExtrinsicGuess)，
+    *         需要调用者保证相同下标为同一目标
+    * @param  如果设置ROI,ROI的偏移量
+    * @retval 解算成功的目标个数
+    */
+    int GetSpatialLocations(const std::vector<std::vector<cv::Point2f>> &Quads, std::vector<Solution> &Solutions,
+                            bool useExtrinsicGuess = false, const cv::Point2f &offset = cv::Point2f(0, 0)) const;
+
+    /**
+    * @brief  批量得到空间位置重载，目标为旋转矩形
+    * @see    GetSpatialLocations
+    */
+    int GetSpatialLocations(const std::vector<cv::RotatedRect> &Rects, std::vector<Solution> &Solutions,
+                            bool useExtrinsicGuess = false, const cv::Point2f &offset = cv::Point2f(0, 0)) const;
+
 private:
+    /**
+    * @brief  解算单个目标
+    * @param  目标四边形的4个2D点
+    * @param  ROI的偏移量
+    * @param  结果，useExtrinsicGuess为true时其中的rvec、tvec为初值
+    * @param  是否使用初值
+    * @retval status
+    */
+    bool Solve(const cv::Point2f *Points2D, const cv::Point2f &offset, Solution &Output,
+               bool useExtrinsicGuess) const;
+
+    /**
+    * @brief  按当前标定参数重建去畸变查找表
+    */
+    void BuildUndistortCache();
+
+    /**
+    * @brief  查表去畸变
+    * @param  像素坐标，成功时替换为去畸变后的像素坐标
+    * @retval 点在网格内时返回true
+    */
+    bool UndistortPoint(cv::Point2f &point) const;
+
     std::string PATH;                   //相机标定XML文件路径
 
     cv::Mat cameraMatrix;               //相机内参矩阵
@@ -84,6 +178,11 @@ private:
     double TargetWidth;                 //目标宽度
 
     std::vector<cv::Point3f> Points3D;  //转化的目标3D点集
+    int PnPMethod = cv::SOLVEPNP_ITERATIVE; //PnP解法
+
+    cv::Size UndistortSize;             //去畸变查找表对应的图像尺寸
+    int UndistortStep = 0;              //去畸变查找表网格间距
+    cv::Mat UndistortMap;               //去畸变查找表，CV_32FC2，网格点去畸变后的像素坐标
 
     SpatialLocation spatial_location;   //目标空间位置
 };
@@ -0,0 +1,124 @@
+/**
+ * @file PoseFilter.h
+ * @brief 目标位姿滤波与预测
+ */
+
+#ifndef KDROBOTCPPLIBS_POSEFILTER_H
+#define KDROBOTCPPLIBS_POSEFILTER_H
+
+#include <opencv2/opencv.hpp>
+#include "coordinate.h"
+
+/**
+ * @brief 目标位姿卡尔曼滤波与预测
+ * @details 对SpatialLocation的x、y、z、Pitch、Yaw、Roll六个分量各自做匀速或匀加速卡尔曼滤波，
+ *          分量间不耦合，状态为[值, 速度, 加速度]，匀速模型的加速度恒为0；
+ *          按帧时间戳计算间隔，过程噪声为白噪声加速度(匀速)或白噪声加加速度(匀加速)。
+ *          predict可以外推到任意未来时刻，用来补偿处理和执行机构的延迟。
+ *          全部运算为固定大小矩阵，不分配内存
+ * @class PoseFilter
+ */
+class PoseFilter {
+public:
+    /**
+     * @brief 运动模型
+     */
+    enum Model {
+        CONSTANT_VELOCITY,      //!<@brief 匀速
+        CONSTANT_ACCELERATION   //!<@brief 匀加速
+    };
+
+    /**
+     * @brief 构造函数
+     * @param model 运动模型
+     * @param positionProcessNoise x、y、z过程噪声谱密度
+     * @param positionMeasurementNoise x、y、z测量噪声标准差，单位与PnP结果相同
+     * @param angleProcessNoise 角度过程噪声谱密度
+     * @param angleMeasurementNoise 角度测量噪声标准差，度
+     * @param resetInterval 两次更新间隔超过此值(秒)时丢弃历史，从测量值重新开始
+     */
+    explicit PoseFilter(Model model = CONSTANT_VELOCITY,
+                        double positionProcessNoise = 1e5, double positionMeasurementNoise = 10,
+                        double angleProcessNoise = 1e3, double angleMeasurementNoise = 2,
+                        double resetInterval = 0.5);
+
+    /**
+     * @brief 融合一次测量
+     * @param measurement GetSpatialLocation得到的位姿
+     * @param timestamp 测量对应的图像时间戳，秒，单调递增
+     * @return 滤波后的位姿
+     */
+    SpatialLocation update(const SpatialLocation &measurement, double timestamp);
+
+    /**
+     * @brief 预测某一时刻的位姿，不改变滤波器状态
+     * @param timestamp 时刻，秒，通常为当前时间加上处理和执行延迟
+     * @return 预测位姿，没有测量时为默认值
+     */
+    SpatialLocation predict(double timestamp) const;
+
+    /**
+     * @brief 当前各分量变化速度，每秒
+     */
+    SpatialLocation velocity() const;
+
+    /**
+     * @brief 丢弃历史，下一次测量重新开始
+     */
+    inline void reset() {
+        initialized = false;
+    }
+
+    /**
+     * @brief 是否已有测量
+     */
+    inline bool isInitialized() const {
+        return initialized;
+    }
+
+    /**
+     * @brief 最后一次测量的时间戳，秒
+     */
+    inline double lastTimestamp() const {
+        return timestamp;
+    }
+
+private:
+    /**
+     * @brief 单个分量的状态
+     */
+    struct Axis {
+        cv::Vec3d x;    //!<@brief 值、速度、加速度
+        cv::Matx33d P;  //!<@brief 状态协方差
+    };
+
+    static const int AXES = 6;
+
+    Model model;
+    double q[AXES];     //!<@brief 过程噪声谱密度
+    double r[AXES];     //!<@brief 测量噪声方差
+    double resetInterval;
+
+    Axis axes[AXES];
+    double timestamp = 0;
+    bool initialized = false;
+
+    /**
+     * @brief 状态转移矩阵
+     * @param dt 时间间隔，秒
+     */
+    cv::Matx33d transition(double dt) const;
+
+    /**
+     * @brief 过程噪声协方差
+     * @param dt 时间间隔，秒
+     * @param q 谱密度
+     */
+    cv::Matx33d processNoise(double dt, double q) const;
+
+    static void toArray(const SpatialLocation &location, double *v);
+
+    static SpatialLocation fromArray(const double *v);
+};
+
+#endif
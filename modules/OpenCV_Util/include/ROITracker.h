@@ -0,0 +1,120 @@
+/**
+ * @file ROITracker.h
+ * @brief 基于感兴趣区域跟踪的阈值化流程
+ */
+
+#ifndef KDROBOTCPPLIBS_ROITRACKER_H
+#define KDROBOTCPPLIBS_ROITRACKER_H
+
+#include <functional>
+#include <stdint.h>
+#include "OpenCV_Util.h"
+
+/**
+ * @brief 基于感兴趣区域跟踪的阈值化流程
+ * @details 上一帧找到目标时，按目标的位置、速度和大小预测本帧ROI，只对ROI做HChannleOffsetInRange和检测；
+ *          ROI中没有找到目标或没有预测时，同一帧内再对整幅图像处理。
+ *          检测函数得到的是ROI内的坐标，ROI左上角即为偏移量，可以直接作为
+ *          PNP_Calculate::GetSpatialLocation的offset参数
+ * @class ROITracker
+ */
+class ROITracker {
+public:
+    /**
+     * @brief 检测函数
+     * @param mask ROI的阈值化结果
+     * @param[out] target 目标在mask中的外接矩形
+     * @return 找到目标时返回true
+     */
+    using Detector = std::function<bool(const cv::Mat &mask, cv::Rect &target)>;
+
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t frames = 0;        //!<@brief 处理帧数
+        uint64_t roiHits = 0;       //!<@brief 在ROI中找到目标的帧数
+        uint64_t fullFrames = 0;    //!<@brief 处理了整幅图像的帧数
+        uint64_t misses = 0;        //!<@brief 没有找到目标的帧数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param offset 通道一偏置
+     * @param lowerb 下限
+     * @param upperb 上限
+     * @param margin ROI相对目标外接矩形每边扩展的比例
+     * @param minSize ROI最小边长，像素
+     */
+    ROITracker(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb,
+               float margin = 1.0f, int minSize = 64);
+
+    /**
+     * @brief 设置阈值
+     * @param offset 通道一偏置
+     * @param lowerb 下限
+     * @param upperb 上限
+     */
+    void setThreshold(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb);
+
+    /**
+     * @brief 处理一帧
+     * @param hsv 输入HSV图像
+     * @param detect 检测函数，每帧调用一次或两次(ROI未找到时对整幅图像再调用一次)
+     * @param[out] mask 最后一次检测使用的阈值化结果，尺寸与roi相同
+     * @param[out] roi 最后一次检测使用的区域，整幅图像坐标；mask中坐标加roi.tl()即为整幅图像坐标
+     * @return 找到目标时返回true
+     */
+    bool process(const cv::Mat &hsv, const Detector &detect, cv::Mat &mask, cv::Rect &roi);
+
+    /**
+     * @brief 丢弃预测，下一帧处理整幅图像
+     */
+    void reset();
+
+    /**
+     * @brief 当前对下一帧的ROI预测，没有预测时为空矩形
+     */
+    inline const cv::Rect &prediction() const {
+        return predicted;
+    }
+
+    inline const Statistics &statistics() const {
+        return stat;
+    }
+
+private:
+    int offset;
+    cv::Scalar lowerb;
+    cv::Scalar upperb;
+    float margin;
+    int minSize;
+
+    cv::Rect predicted;         //!<@brief 对下一帧的ROI预测
+    cv::Point2f lastCenter;     //!<@brief 上一次找到的目标中心
+    cv::Point2f velocity;       //!<@brief 目标中心每帧位移
+    bool tracking = false;      //!<@brief 上一帧是否找到目标
+
+    Statistics stat;
+
+    /**
+     * @brief 在一个区域内阈值化并检测
+     * @param hsv 输入HSV图像
+     * @param area 区域
+     * @param detect 检测函数
+     * @param[out] mask 阈值化结果
+     * @param[out] target 目标在整幅图像中的外接矩形
+     * @return 找到目标时返回true
+     */
+    bool detectIn(const cv::Mat &hsv, const cv::Rect &area, const Detector &detect, cv::Mat &mask,
+                  cv::Rect &target) const;
+
+    /**
+     * @brief 找到目标后更新速度和下一帧预测
+     * @param target 目标在整幅图像中的外接矩形
+     * @param frame 整幅图像区域
+     */
+    void update(const cv::Rect &target, const cv::Rect &frame);
+};
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * @file HSVThreshold.cpp
+ */
+
+#include "HSVThreshold.h"
+#include <stdexcept>
+#include <string.h>
+
+HSVThreshold::HSVThreshold() {
+    build();
+}
+
+HSVThreshold::HSVThreshold(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb) : HSVThreshold() {
+    set(offset, lowerb, upperb);
+}
+
+HSVThreshold::HSVThreshold(const std::vector<HSVRange> &ranges) : HSVThreshold() {
+    set(ranges);
+}
+
+bool HSVThreshold::set(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb) {
+    return set(std::vector<HSVRange>{{offset, lowerb, upperb}});
+}
+
+bool HSVThreshold::set(const std::vector<HSVRange> &ranges) {
+    if (ranges.size() > MAX_RANGES)
+        throw std::invalid_argument("too many ranges");
+    if (ranges == this->ranges)
+        return false;
+    this->ranges = ranges;
+    build();
+    return true;
+}
+
+void HSVThreshold::build() {
+    memset(H_LUT, 0, sizeof(H_LUT));
+    memset(S_LUT, 0, sizeof(S_LUT));
+    memset(V_LUT, 0, sizeof(V_LUT));
+    for (size_t j = 0; j < ranges.size(); j++) {
+        const HSVRange &r = ranges[j];
+        // 与HChannleOffsetInRange的判断逐项相同
+        int16_t H_Upper = (int16_t) r.upperb[0] + r.offset, H_Lower = (int16_t) r.lowerb[0] + r.offset;
+        int16_t S_Upper = (int16_t) r.upperb[1], S_Lower = (int16_t) r.lowerb[1];
+        int16_t V_Upper = (int16_t) r.upperb[2], V_Lower = (int16_t) r.lowerb[2];
+        uint8_t bit = 1 << j;
+        for (int i = 0; i < 256; i++) {
+            int16_t H = ((int16_t) i + r.offset) % 180;
+            if (H_Lower <= H && H <= H_Upper)
+                H_LUT[i] |= bit;
+            if (S_Lower <= i && i <= S_Upper)
+                S_LUT[i] |= bit;
+            if (V_Lower <= i && i <= V_Upper)
+                V_LUT[i] |= bit;
+        }
+    }
+}
+
+void HSVThreshold::apply(const cv::Mat &Input, cv::Mat &dst) const {
+    CV_Assert(Input.depth() == CV_8U && Input.channels() >= 3);
+    if (ranges.size() == 1) {
+        // 单个范围时向量化比较比逐像素查表快
+        HChannleOffsetInRange(Input, ranges[0].offset, ranges[0].lowerb, ranges[0].upperb, dst);
+        return;
+    }
+    int chs = Input.channels();
+    dst.create(Input.rows, Input.cols, CV_8U);
+    cv::parallel_for_(cv::Range(0, Input.rows), [&](const cv::Range &range) {
+        for (int k = range.start; k < range.end; k++) {
+            const uchar *inData = Input.ptr<uchar>(k);
+            uchar *outData = dst.ptr<uchar>(k);
+            for (int i = 0; i < Input.cols; i++, inData += chs)
+                outData[i] = (H_LUT[inData[0]] & S_LUT[inData[1]] & V_LUT[inData[2]]) ? 0xff : 0x00;
+        }
+    });
+}
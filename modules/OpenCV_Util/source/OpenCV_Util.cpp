@@ -5,7 +5,8 @@
  */
 
 #include "OpenCV_Util.h"
-#include "omp.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <limits>
 
 void drawRotatedRect(cv::InputOutputArray Img, cv::RotatedRect rect,
                      const cv::Scalar &color, int thickness, int lineType, int shift) {
@@ -36,32 +37,155 @@ cv::Point3f Rotation3D_Z(const cv::Point3f &point, float z) {
             point.z};
 }
 
+namespace {
+    /**
+     * @brief HChannleOffsetInRange的阈值，S、V已截断到[0, 255]
+     */
+    struct OffsetInRangeBounds {
+        int offset;
+        int16_t H_Lower, H_Upper;
+        uint8_t S_Lower, S_Upper;
+        uint8_t V_Lower, V_Upper;
+    };
+
+    /**
+     * @brief 处理一行像素
+     * @param inData 输入行指针
+     * @param outData 输出行指针
+     * @param cols 列数
+     * @param chs 输入通道数
+     * @param b 阈值
+     * @param accumulate 为true时与输出行已有结果按位或，用于多个范围
+     */
+    void offsetInRangeRow(const uchar *inData, uchar *outData, int cols, int chs, const OffsetInRangeBounds &b,
+                          bool accumulate = false) {
+        int i = 0;
+#if CV_SIMD
+        /* 偏置在[-180, 180]内时H+offset在[-180, 435]，两次比较减180、一次比较加180即与C++的%180结果一致 */
+        if ((chs == 3 || chs == 4) && -180 <= b.offset && b.offset <= 180) {
+            const int step = cv::v_uint8::nlanes;
+            const cv::v_int16 v_offset = cv::vx_setall_s16((int16_t) b.offset);
+            const cv::v_int16 v_180 = cv::vx_setall_s16(180), v_n180 = cv::vx_setall_s16(-180);
+            const cv::v_int16 v_hl = cv::vx_setall_s16(b.H_Lower), v_hu = cv::vx_setall_s16(b.H_Upper);
+            const cv::v_uint8 v_sl = cv::vx_setall_u8(b.S_Lower), v_su = cv::vx_setall_u8(b.S_Upper);
+            const cv::v_uint8 v_vl = cv::vx_setall_u8(b.V_Lower), v_vu = cv::vx_setall_u8(b.V_Upper);
+            for (; i <= cols - step; i += step) {
+                cv::v_uint8 h, s, v, a;
+                if (chs == 3)
+                    cv::v_load_deinterleave(inData + i * 3, h, s, v);
+                else
+                    cv::v_load_deinterleave(inData + i * 4, h, s, v, a);
+                cv::v_uint16 h0, h1;
+                cv::v_expand(h, h0, h1);
+                cv::v_int16 H0 = cv::v_reinterpret_as_s16(h0) + v_offset;
+                cv::v_int16 H1 = cv::v_reinterpret_as_s16(h1) + v_offset;
+                H0 = H0 - (v_180 & (H0 >= v_180));
+                H1 = H1 - (v_180 & (H1 >= v_180));
+                H0 = H0 - (v_180 & (H0 >= v_180));
+                H1 = H1 - (v_180 & (H1 >= v_180));
+                H0 = H0 + (v_180 & (H0 <= v_n180));
+                H1 = H1 + (v_180 & (H1 <= v_n180));
+                /* 比较结果为0或-1，饱和打包后为0x00或0xff */
+                cv::v_uint8 mask = cv::v_reinterpret_as_u8(cv::v_pack((v_hl <= H0) & (H0 <= v_hu),
+                                                                      (v_hl <= H1) & (H1 <= v_hu)));
+                mask = mask & (v_sl <= s) & (s <= v_su) & (v_vl <= v) & (v <= v_vu);
+                if (accumulate)
+                    mask = mask | cv::vx_load(outData + i);
+                cv::v_store(outData + i, mask);
+            }
+        }
+#endif
+        for (; i < cols; i++) {
+            const uchar *p = inData + i * chs;
+            int16_t H = ((int16_t) p[0] + b.offset) % 180;
+            uint8_t S = p[1];
+            uint8_t V = p[2];
+            uchar mask = (b.H_Lower <= H && H <= b.H_Upper &&
+                          b.S_Lower <= S && S <= b.S_Upper &&
+                          b.V_Lower <= V && V <= b.V_Upper) ? 0xff : 0x00;
+            outData[i] = accumulate ? (uchar) (outData[i] | mask) : mask;
+        }
+    }
+
+    /**
+     * @brief 计算阈值，S、V截断到[0, 255]
+     * @param offset 通道一偏置
+     * @param lowerb 下限
+     * @param upperb 上限
+     * @param[out] b 阈值
+     * @return S或V范围为空时返回false，此时不会有像素通过
+     */
+    bool makeOffsetInRangeBounds(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb,
+                                 OffsetInRangeBounds &b) {
+        int16_t S_Upper = (int16_t) upperb[1], S_Lower = (int16_t) lowerb[1];
+        int16_t V_Upper = (int16_t) upperb[2], V_Lower = (int16_t) lowerb[2];
+        S_Lower = std::max<int16_t>(S_Lower, 0);
+        S_Upper = std::min<int16_t>(S_Upper, 255);
+        V_Lower = std::max<int16_t>(V_Lower, 0);
+        V_Upper = std::min<int16_t>(V_Upper, 255);
+        b = {offset,
+             (int16_t) ((int16_t) lowerb[0] + offset), (int16_t) ((int16_t) upperb[0] + offset),
+             (uint8_t) S_Lower, (uint8_t) S_Upper, (uint8_t) V_Lower, (uint8_t) V_Upper};
+        return S_Lower <= S_Upper && V_Lower <= V_Upper;
+    }
+
+    //! 融合转换时每块HSV缓存的字节数，保证缓存块留在L1/L2中
+    const int FUSED_BLOCK_BYTES = 16 * 1024;
+}
+
 void HChannleOffsetInRange(const cv::Mat &Input, int offset, const cv::Scalar &lowerb,
                            const cv::Scalar &upperb, cv::Mat &dst) {
-    int nr = Input.rows;
-    // 将3通道转换为1通道
+    CV_Assert(Input.depth() == CV_8U && Input.channels() >= 3);
     int chs = Input.channels();
-    int nl = Input.cols * chs;
     dst.create(Input.rows, Input.cols, CV_8U);
 
-    int16_t H_Upper = (int16_t) upperb[0] + offset, H_Lower = (int16_t) lowerb[0] + offset;
-    int16_t S_Upper = (int16_t) upperb[1], S_Lower = (int16_t) lowerb[1];
-    int16_t V_Upper = (int16_t) upperb[2], V_Lower = (int16_t) lowerb[2];
-#pragma omp parallel for
-    for (int k = 0; k < nr; k++) {
-        // 每一行图像的指针
-        const uchar *inData = Input.ptr<uchar>(k);
-        uchar *outData = dst.ptr<uchar>(k);
-#pragma omp parallel for
-        for (int i = 0; i < nl; i += 3) {
-            int16_t H = ((int16_t) inData[i] + offset) % 180;
-            uint8_t S = inData[i + 1];
-            uint8_t V = inData[i + 2];
-            outData[i / 3] = (H_Lower <= H && H <= H_Upper &&
-                              S_Lower <= S && S <= S_Upper &&
-                              V_Lower <= V && V <= V_Upper) ? 0xff : 0x00;
-        }
+    OffsetInRangeBounds b;
+    if (!makeOffsetInRangeBounds(offset, lowerb, upperb, b)) {
+        dst.setTo(0);
+        return;
     }
+    // 按行条带并行，每个条带内逐行向量化
+    cv::parallel_for_(cv::Range(0, Input.rows), [&](const cv::Range &range) {
+        for (int k = range.start; k < range.end; k++)
+            offsetInRangeRow(Input.ptr<uchar>(k), dst.ptr<uchar>(k), Input.cols, chs, b);
+    });
+}
+
+void BGR2HSVOffsetInRange(const cv::Mat &Input, const std::vector<HSVRange> &ranges, cv::Mat &dst) {
+    CV_Assert(Input.depth() == CV_8U && (Input.channels() == 3 || Input.channels() == 4));
+    dst.create(Input.rows, Input.cols, CV_8U);
+
+    std::vector<OffsetInRangeBounds> bounds;
+    bounds.reserve(ranges.size());
+    for (const HSVRange &range : ranges) {
+        OffsetInRangeBounds b;
+        if (makeOffsetInRangeBounds(range.offset, range.lowerb, range.upperb, b))
+            bounds.push_back(b);
+    }
+    if (bounds.empty()) {
+        dst.setTo(0);
+        return;
+    }
+    const int blockRows = std::max(1, FUSED_BLOCK_BYTES / std::max(1, Input.cols * 3));
+    cv::parallel_for_(cv::Range(0, Input.rows), [&](const cv::Range &range) {
+        // 每个条带一个HSV缓存块，逐块转换后立即阈值化，HSV图像不写回内存
+        cv::Mat hsv;
+        for (int k0 = range.start; k0 < range.end; k0 += blockRows) {
+            int k1 = std::min(k0 + blockRows, range.end);
+            cv::cvtColor(Input.rowRange(k0, k1), hsv, cv::COLOR_BGR2HSV);
+            for (int k = k0; k < k1; k++) {
+                const uchar *inData = hsv.ptr<uchar>(k - k0);
+                uchar *outData = dst.ptr<uchar>(k);
+                for (size_t r = 0; r < bounds.size(); r++)
+                    offsetInRangeRow(inData, outData, Input.cols, 3, bounds[r], r > 0);
+            }
+        }
+    });
+}
+
+void BGR2HSVOffsetInRange(const cv::Mat &Input, int offset, const cv::Scalar &lowerb,
+                          const cv::Scalar &upperb, cv::Mat &dst) {
+    BGR2HSVOffsetInRange(Input, std::vector<HSVRange>{{offset, lowerb, upperb}}, dst);
 }
 
 cv::Point3f Rotation3D(const cv::Point3f &point, const char *order, float v1, float v2, float v3) {
@@ -87,3 +211,263 @@ cv::Point3f Rotation3D(const cv::Point3f &point, const char *order, float v1, fl
     }
     return p;
 }
+
+namespace {
+    //! 批量旋转时每个并行块的点数
+    const size_t ROTATION_BLOCK = 4096;
+
+    /**
+     * @brief 批量旋转一段连续的点
+     * @param R 旋转矩阵
+     * @param src 输入x、y、z
+     * @param dst 输出x、y、z
+     * @param count 点数
+     */
+    void rotateBlock(const cv::Matx33f &R, const float *src, float *dst, size_t count) {
+        size_t i = 0;
+#if CV_SIMD
+        const size_t step = cv::v_float32::nlanes;
+        const cv::v_float32 r00 = cv::vx_setall_f32(R(0, 0)), r01 = cv::vx_setall_f32(R(0, 1)),
+                r02 = cv::vx_setall_f32(R(0, 2)), r10 = cv::vx_setall_f32(R(1, 0)),
+                r11 = cv::vx_setall_f32(R(1, 1)), r12 = cv::vx_setall_f32(R(1, 2)),
+                r20 = cv::vx_setall_f32(R(2, 0)), r21 = cv::vx_setall_f32(R(2, 1)),
+                r22 = cv::vx_setall_f32(R(2, 2));
+        for (; i + step <= count; i += step) {
+            cv::v_float32 x, y, z;
+            cv::v_load_deinterleave(src + i * 3, x, y, z);
+            cv::v_float32 nx = cv::v_muladd(r02, z, cv::v_muladd(r01, y, r00 * x));
+            cv::v_float32 ny = cv::v_muladd(r12, z, cv::v_muladd(r11, y, r10 * x));
+            cv::v_float32 nz = cv::v_muladd(r22, z, cv::v_muladd(r21, y, r20 * x));
+            cv::v_store_interleave(dst + i * 3, nx, ny, nz);
+        }
+#endif
+        for (; i < count; i++) {
+            float x = src[i * 3], y = src[i * 3 + 1], z = src[i * 3 + 2];
+            dst[i * 3] = R(0, 0) * x + R(0, 1) * y + R(0, 2) * z;
+            dst[i * 3 + 1] = R(1, 0) * x + R(1, 1) * y + R(1, 2) * z;
+            dst[i * 3 + 2] = R(2, 0) * x + R(2, 1) * y + R(2, 2) * z;
+        }
+    }
+}
+
+Rotation3DMatrix::Rotation3DMatrix() : R(cv::Matx33f::eye()) {}
+
+Rotation3DMatrix::Rotation3DMatrix(const char *order, float v1, float v2, float v3) {
+    // 与Rotation3D_X、Rotation3D_Y、Rotation3D_Z相同的矩阵，依次左乘
+    cv::Matx33d M = cv::Matx33d::eye();
+    double a[] = {v1, v2, v3};
+    for (int i = 0; i < 3 && order[i] != 0; i++) {
+        double s = sin(a[i]), c = cos(a[i]);
+        switch (order[i]) {
+            case 'x':
+            case 'X':
+                M = cv::Matx33d(1, 0, 0,
+                                0, c, s,
+                                0, -s, c) * M;
+                break;
+            case 'y':
+            case 'Y':
+                M = cv::Matx33d(c, 0, -s,
+                                0, 1, 0,
+                                s, 0, c) * M;
+                break;
+            case 'z':
+            case 'Z':
+                M = cv::Matx33d(c, s, 0,
+                                -s, c, 0,
+                                0, 0, 1) * M;
+                break;
+            default:
+                throw std::invalid_argument("顺序字符串错误");
+        }
+    }
+    R = M;
+}
+
+void Rotation3DMatrix::apply(const cv::Point3f *src, cv::Point3f *dst, size_t count) const {
+    const float *s = &src->x;
+    float *d = &dst->x;
+    if (count <= ROTATION_BLOCK) {
+        rotateBlock(R, s, d, count);
+        return;
+    }
+    int blocks = (int) ((count + ROTATION_BLOCK - 1) / ROTATION_BLOCK);
+    cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range &range) {
+        size_t begin = range.start * ROTATION_BLOCK;
+        size_t end = std::min(count, range.end * ROTATION_BLOCK);
+        rotateBlock(R, s + begin * 3, d + begin * 3, end - begin);
+    });
+}
+
+void Rotation3DMatrix::apply(const std::vector<cv::Point3f> &src, std::vector<cv::Point3f> &dst) const {
+    dst.resize(src.size());
+    if (!src.empty())
+        apply(src.data(), dst.data(), src.size());
+}
+
+void Rotation3DMatrix::apply(const cv::Mat &src, cv::Mat &dst) const {
+    CV_Assert(src.type() == CV_32FC3 || (src.type() == CV_32FC1 && src.cols == 3));
+    dst.create(src.size(), src.type());
+    if (src.isContinuous() && dst.isContinuous()) {
+        apply(src.ptr<cv::Point3f>(), dst.ptr<cv::Point3f>(), src.total() * src.channels() / 3);
+        return;
+    }
+    for (int k = 0; k < src.rows; k++)
+        rotateBlock(R, src.ptr<float>(k), dst.ptr<float>(k), src.cols * src.channels() / 3);
+}
+
+void Rotation3D(const cv::Point3f *src, cv::Point3f *dst, size_t count,
+                const char *order, float v1, float v2, float v3) {
+    Rotation3DMatrix(order, v1, v2, v3).apply(src, dst, count);
+}
+
+void Rotation3D(const cv::Mat &src, cv::Mat &dst, const char *order, float v1, float v2, float v3) {
+    Rotation3DMatrix(order, v1, v2, v3).apply(src, dst);
+}
+
+namespace {
+    /**
+     * @brief 批量点到点距离
+     * @tparam N 维数，2或3
+     * @tparam Pairwise 为true时a逐点对应，否则a只有一个点
+     */
+    template<int N, bool Pairwise>
+    void distenceBatch(const float *a, const float *b, float *dst, size_t count, bool squared) {
+        size_t i = 0;
+#if CV_SIMD
+        const size_t step = cv::v_float32::nlanes;
+        cv::v_float32 pa[3], pb[3];
+        if (!Pairwise) {
+            for (int c = 0; c < N; c++)
+                pa[c] = cv::vx_setall_f32(a[c]);
+        }
+        for (; i + step <= count; i += step) {
+            if (N == 2) {
+                cv::v_load_deinterleave(b + i * 2, pb[0], pb[1]);
+                if (Pairwise)
+                    cv::v_load_deinterleave(a + i * 2, pa[0], pa[1]);
+            } else {
+                cv::v_load_deinterleave(b + i * 3, pb[0], pb[1], pb[2]);
+                if (Pairwise)
+                    cv::v_load_deinterleave(a + i * 3, pa[0], pa[1], pa[2]);
+            }
+            cv::v_float32 d = pa[0] - pb[0];
+            cv::v_float32 sum = d * d;
+            for (int c = 1; c < N; c++) {
+                d = pa[c] - pb[c];
+                sum = cv::v_muladd(d, d, sum);
+            }
+            cv::v_store(dst + i, squared ? sum : cv::v_sqrt(sum));
+        }
+#endif
+        for (; i < count; i++) {
+            const float *p = Pairwise ? a + i * N : a;
+            float sum = 0;
+            for (int c = 0; c < N; c++) {
+                float d = p[c] - b[i * N + c];
+                sum += d * d;
+            }
+            dst[i] = squared ? sum : std::sqrt(sum);
+        }
+    }
+
+    /**
+     * @brief 最近点，比较距离平方
+     * @tparam N 维数，2或3
+     */
+    template<int N>
+    int nearestBatch(const float *p, const float *points, size_t count, float *distance) {
+        if (count == 0)
+            return -1;
+        size_t i = 0;
+        float best = std::numeric_limits<float>::infinity();
+        int bestIndex = 0;
+#if CV_SIMD
+        const int step = cv::v_float32::nlanes;
+        if (count >= (size_t) step) {
+            cv::v_float32 pv[3], q[3];
+            for (int c = 0; c < N; c++)
+                pv[c] = cv::vx_setall_f32(p[c]);
+            // 每个通道各自记录最小值及其下标，严格小于才替换，保证取第一个
+            int lanes[cv::v_int32::nlanes];
+            for (int k = 0; k < step; k++)
+                lanes[k] = k;
+            cv::v_int32 index = cv::vx_load(lanes), laneBest = cv::vx_setall_s32(0);
+            const cv::v_int32 v_step = cv::vx_setall_s32(step);
+            cv::v_float32 minimum = cv::vx_setall_f32(best);
+            for (; i + step <= count; i += step) {
+                if (N == 2)
+                    cv::v_load_deinterleave(points + i * 2, q[0], q[1]);
+                else
+                    cv::v_load_deinterleave(points + i * 3, q[0], q[1], q[2]);
+                cv::v_float32 d = pv[0] - q[0];
+                cv::v_float32 sum = d * d;
+                for (int c = 1; c < N; c++) {
+                    d = pv[c] - q[c];
+                    sum = cv::v_muladd(d, d, sum);
+                }
+                cv::v_float32 less = sum < minimum;
+                minimum = cv::v_select(less, sum, minimum);
+                laneBest = cv::v_select(cv::v_reinterpret_as_s32(less), index, laneBest);
+                index = index + v_step;
+            }
+            float minimums[cv::v_float32::nlanes];
+            cv::v_store(minimums, minimum);
+            cv::v_store(lanes, laneBest);
+            for (int k = 0; k < step; k++) {
+                if (minimums[k] < best || (minimums[k] == best && lanes[k] < bestIndex)) {
+                    best = minimums[k];
+                    bestIndex = lanes[k];
+                }
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            float sum = 0;
+            for (int c = 0; c < N; c++) {
+                float d = p[c] - points[i * N + c];
+                sum += d * d;
+            }
+            if (sum < best) {
+                best = sum;
+                bestIndex = (int) i;
+            }
+        }
+        if (distance)
+            *distance = std::sqrt(best);
+        return bestIndex;
+    }
+}
+
+void distenceP2P(const cv::Point2f *a, const cv::Point2f *b, float *dst, size_t count, bool squared) {
+    distenceBatch<2, true>(&a->x, &b->x, dst, count, squared);
+}
+
+void distenceP2P(const cv::Point2f &p, const cv::Point2f *points, float *dst, size_t count, bool squared) {
+    distenceBatch<2, false>(&p.x, &points->x, dst, count, squared);
+}
+
+void distence3P2P(const cv::Point3f *a, const cv::Point3f *b, float *dst, size_t count, bool squared) {
+    distenceBatch<3, true>(&a->x, &b->x, dst, count, squared);
+}
+
+void distence3P2P(const cv::Point3f &p, const cv::Point3f *points, float *dst, size_t count, bool squared) {
+    distenceBatch<3, false>(&p.x, &points->x, dst, count, squared);
+}
+
+int nearestPoint(const cv::Point2f &p, const cv::Point2f *points, size_t count, float *distance) {
+    return nearestBatch<2>(&p.x, &points->x, count, distance);
+}
+
+int nearestPoint(const cv::Point3f &p, const cv::Point3f *points, size_t count, float *distance) {
+    return nearestBatch<3>(&p.x, &points->x, count, distance);
+}
+
+void distenceMatrix(const std::vector<cv::Point2f> &a, const std::vector<cv::Point2f> &b, cv::Mat &dst,
+                    bool squared) {
+    dst.create((int) a.size(), (int) b.size(), CV_32F);
+    if (b.empty())
+        return;
+    for (size_t i = 0; i < a.size(); i++)
+        distenceP2P(a[i], b.data(), dst.ptr<float>((int) i), b.size(), squared);
+}
@@ -5,6 +5,10 @@
  */
 
 #include "PNP_Calculate.h"
+#include <atomic>
+
+//OpenCV 4.1起支持平面PnP闭式解SOLVEPNP_IPPE、SOLVEPNP_IPPE_SQUARE
+#define PNP_HAS_IPPE (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 1))
 
 PNP_Calculate::PNP_Calculate(const PNP_Calculate &Copy) {
     cameraMatrix = Copy.cameraMatrix;
@@ -18,6 +22,10 @@ PNP_Calculate::PNP_Calculate(const PNP_Calculate &Copy) {
 
     if (TargetHeight != 0 && TargetWidth != 0)
         SetTargetSize(TargetHeight, TargetWidth);
+    PnPMethod = Copy.PnPMethod;
+    UndistortSize = Copy.UndistortSize;
+    UndistortStep = Copy.UndistortStep;
+    UndistortMap = Copy.UndistortMap;
 }
 
 PNP_Calculate::PNP_Calculate(const std::string XML_PATH) {
@@ -39,6 +47,8 @@ bool PNP_Calculate::Init(const std::string XML_PATH) {
         params["camera-matrix"] >> cameraMatrix;
         params["distortion"] >> distortion;
         params.release();
+        if (UndistortStep > 0)
+            BuildUndistortCache();
         return true;
     }
 
@@ -59,59 +69,162 @@ void PNP_Calculate::SetTargetSize(double height, double width) {
     Points3D.push_back(cv::Point3f((float) half_x, (float) -half_y, 0.0f));
     Points3D.push_back(cv::Point3f((float) half_x, (float) half_y, 0.0f));
     Points3D.push_back(cv::Point3f((float) -half_x, (float) half_y, 0.0f));
+
+    //4点共面，使用IPPE闭式解
+#if PNP_HAS_IPPE
+    PnPMethod = TargetHeight == TargetWidth ? cv::SOLVEPNP_IPPE_SQUARE : cv::SOLVEPNP_IPPE;
+#endif
 }
 
-bool PNP_Calculate::GetSpatialLocation(SpatialLocation &Output, std::vector<cv::Point2f> Points2D,
-                                       const cv::Point2f &offset) {
-    if (Points2D.size() < 4)
+void PNP_Calculate::EnableUndistortCache(const cv::Size &imageSize, int gridStep) {
+    if (imageSize.area() <= 0 || gridStep <= 0)
+        throw std::invalid_argument("invalid undistort cache size");
+    UndistortSize = imageSize;
+    UndistortStep = gridStep;
+    BuildUndistortCache();
+}
+
+void PNP_Calculate::DisableUndistortCache() {
+    UndistortStep = 0;
+    UndistortMap.release();
+}
+
+void PNP_Calculate::BuildUndistortCache() {
+    //网格覆盖[0, 宽]x[0, 高]，保证图像内任意点都有右下相邻网格点
+    int cols = (UndistortSize.width + UndistortStep - 1) / UndistortStep + 1;
+    int rows = (UndistortSize.height + UndistortStep - 1) / UndistortStep + 1;
+    cv::Mat grid(rows, cols, CV_32FC2);
+    for (int y = 0; y < rows; y++) {
+        auto *p = grid.ptr<cv::Point2f>(y);
+        for (int x = 0; x < cols; x++)
+            p[x] = cv::Point2f((float) (x * UndistortStep), (float) (y * UndistortStep));
+    }
+    //P取相机内参，输出仍为像素坐标
+    cv::undistortPoints(grid.reshape(2, rows * cols), UndistortMap, cameraMatrix, distortion,
+                        cv::noArray(), cameraMatrix);
+    UndistortMap = UndistortMap.reshape(2, rows);
+}
+
+bool PNP_Calculate::UndistortPoint(cv::Point2f &point) const {
+    float gx = point.x / UndistortStep, gy = point.y / UndistortStep;
+    int x0 = cvFloor(gx), y0 = cvFloor(gy);
+    if (x0 < 0 || y0 < 0 || x0 + 1 >= UndistortMap.cols || y0 + 1 >= UndistortMap.rows)
         return false;
+    float fx = gx - x0, fy = gy - y0;
+    const cv::Point2f *r0 = UndistortMap.ptr<cv::Point2f>(y0) + x0;
+    const cv::Point2f *r1 = UndistortMap.ptr<cv::Point2f>(y0 + 1) + x0;
+    point = (r0[0] * (1 - fx) + r0[1] * fx) * (1 - fy) + (r1[0] * (1 - fx) + r1[1] * fx) * fy;
+    return true;
+}
 
-    cv::Point2f lt, ld, rt, rd;
+bool PNP_Calculate::Solve(const cv::Point2f *Points2D, const cv::Point2f &offset, Solution &Output,
+                          bool useExtrinsicGuess) const {
+    cv::Point2f points[4] = {Points2D[0], Points2D[1], Points2D[2], Points2D[3]};
 
     //对点集按x排序
-    auto it = Points2D.begin();
-    std::sort(it, it + 4, [](const cv::Point2f &p1, const cv::Point2f &p2) { return p1.x < p2.x; });
-
-    //对点集按y排序
-    if (Points2D[0].y < Points2D[1].y) {
-        lt = Points2D[0];
-        ld = Points2D[1];
-    } else {
-        lt = Points2D[1];
-        ld = Points2D[0];
-    }
-    if (Points2D[2].y < Points2D[3].y) {
-        rt = Points2D[2];
-        rd = Points2D[3];
-    } else {
-        rt = Points2D[3];
-        rd = Points2D[2];
+    std::sort(points, points + 4, [](const cv::Point2f &p1, const cv::Point2f &p2) { return p1.x < p2.x; });
+
+    //对点集按y排序，加偏置，按lt、rt、rd、ld顺序存放
+    cv::Point2f target2d[4];
+    bool left = points[0].y < points[1].y, right = points[2].y < points[3].y;
+    target2d[0] = (left ? points[0] : points[1]) + offset;  //lt
+    target2d[3] = (left ? points[1] : points[0]) + offset;  //ld
+    target2d[1] = (right ? points[2] : points[3]) + offset; //rt
+    target2d[2] = (right ? points[3] : points[2]) + offset; //rd
+
+    //查表去畸变，全部角点在网格内时以零畸变解算
+    static const cv::Mat noDistortion;
+    const cv::Mat *dist = &distortion;
+    if (!UndistortMap.empty()) {
+        cv::Point2f undistorted[4] = {target2d[0], target2d[1], target2d[2], target2d[3]};
+        if (UndistortPoint(undistorted[0]) && UndistortPoint(undistorted[1]) &&
+            UndistortPoint(undistorted[2]) && UndistortPoint(undistorted[3])) {
+            std::copy(undistorted, undistorted + 4, target2d);
+            dist = &noDistortion;
+        }
     }
 
-    std::vector<cv::Point2f> target2d;
+    //PnP解算，输入输出均为固定大小，不分配内存
+    bool res;
+    if (useExtrinsicGuess || PnPMethod == cv::SOLVEPNP_ITERATIVE) {
+        res = cv::solvePnP(Points3D, cv::Mat(4, 1, CV_32FC2, target2d), cameraMatrix, *dist,
+                           Output.rvec, Output.tvec, useExtrinsicGuess);
+    }
+#if PNP_HAS_IPPE
+    else if (PnPMethod == cv::SOLVEPNP_IPPE_SQUARE) {
+        //IPPE_SQUARE要求3D点按(-,+)、(+,+)、(+,-)、(-,-)排列，即Points3D的逆序
+        const cv::Point3f square3d[4] = {Points3D[3], Points3D[2], Points3D[1], Points3D[0]};
+        cv::Point2f square2d[4] = {target2d[3], target2d[2], target2d[1], target2d[0]};
+        res = cv::solvePnP(cv::Mat(4, 1, CV_32FC3, (void *) square3d), cv::Mat(4, 1, CV_32FC2, square2d),
+                           cameraMatrix, *dist, Output.rvec, Output.tvec, false, PnPMethod);
+    }
+#endif
+    else {
+        res = cv::solvePnP(Points3D, cv::Mat(4, 1, CV_32FC2, target2d), cameraMatrix, *dist,
+                           Output.rvec, Output.tvec, false, PnPMethod);
+    }
+    if (res) {
+        //对输出进行单位换算，分类
+        Output.location.Pitch = atan(Output.rvec[0]) / CV_2PI * 360;
+        Output.location.Yaw = atan(Output.rvec[1]) / CV_2PI * 360;
+        Output.location.Roll = atan(Output.rvec[2]) / CV_2PI * 360;
+        Output.location.x = Output.tvec[0];
+        Output.location.y = Output.tvec[1];
+        Output.location.z = Output.tvec[2];
+    }
+    Output.valid = res;
+    return res;
+}
 
-    //加偏置，压入向量
-    target2d.push_back(lt + offset); //0
-    target2d.push_back(rt + offset); //1
-    target2d.push_back(rd + offset); //2
-    target2d.push_back(ld + offset); //3
+bool PNP_Calculate::GetSpatialLocation(SpatialLocation &Output, const std::vector<cv::Point2f> &Points2D,
+                                       const cv::Point2f &offset) {
+    if (Points2D.size() < 4)
+        return false;
 
-    //PnP解算
-    cv::Mat r, trans;
-    bool res = cv::solvePnP(Points3D, target2d, cameraMatrix, distortion, r, trans);
+    Solution solution;
+    bool res = Solve(Points2D.data(), offset, solution, false);
     if (res) {
-        //对输出进行单位换算，分类
-        spatial_location.Pitch = atan(r.at<double>(0, 0)) / CV_2PI * 360;
-        spatial_location.Yaw = atan(r.at<double>(0, 1)) / CV_2PI * 360;
-        spatial_location.Roll = atan(r.at<double>(0, 2)) / CV_2PI * 360;
-        spatial_location.x = trans.at<double>(0, 0);
-        spatial_location.y = trans.at<double>(1, 0);
-        spatial_location.z = trans.at<double>(2, 0);
+        spatial_location = solution.location;
         Output = spatial_location;
     }
     return res;
 }
 
+int PNP_Calculate::GetSpatialLocations(const std::vector<std::vector<cv::Point2f>> &Quads,
+                                       std::vector<Solution> &Solutions, bool useExtrinsicGuess,
+                                       const cv::Point2f &offset) const {
+    //只有上一次成功的结果可以作为初值，新增的目标没有初值
+    Solutions.resize(Quads.size());
+    std::atomic<int> count(0);
+    cv::parallel_for_(cv::Range(0, (int) Quads.size()), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            Solution &solution = Solutions[i];
+            if (Quads[i].size() < 4) {
+                solution.valid = false;
+                continue;
+            }
+            if (Solve(Quads[i].data(), offset, solution, useExtrinsicGuess && solution.valid))
+                count++;
+        }
+    });
+    return count;
+}
+
+int PNP_Calculate::GetSpatialLocations(const std::vector<cv::RotatedRect> &Rects, std::vector<Solution> &Solutions,
+                                       bool useExtrinsicGuess, const cv::Point2f &offset) const {
+    Solutions.resize(Rects.size());
+    std::atomic<int> count(0);
+    cv::parallel_for_(cv::Range(0, (int) Rects.size()), [&](const cv::Range &range) {
+        cv::Point2f points[4];
+        for (int i = range.start; i < range.end; i++) {
+            Rects[i].points(points);
+            if (Solve(points, offset, Solutions[i], useExtrinsicGuess && Solutions[i].valid))
+                count++;
+        }
+    });
+    return count;
+}
+
 SpatialLocation PNP_Calculate::GetSpatialLocation(void) {
     return spatial_location;
 }
\ No newline at end of file
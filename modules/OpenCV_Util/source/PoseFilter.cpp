@@ -0,0 +1,107 @@
+/**
+ * @file PoseFilter.cpp
+ */
+
+#include "PoseFilter.h"
+
+PoseFilter::PoseFilter(Model model, double positionProcessNoise, double positionMeasurementNoise,
+                       double angleProcessNoise, double angleMeasurementNoise, double resetInterval) :
+        model(model), resetInterval(resetInterval) {
+    for (int i = 0; i < AXES; i++) {
+        // 前3个分量为x、y、z，后3个为Pitch、Yaw、Roll
+        q[i] = i < 3 ? positionProcessNoise : angleProcessNoise;
+        r[i] = i < 3 ? positionMeasurementNoise * positionMeasurementNoise
+                     : angleMeasurementNoise * angleMeasurementNoise;
+    }
+}
+
+void PoseFilter::toArray(const SpatialLocation &location, double *v) {
+    v[0] = location.x;
+    v[1] = location.y;
+    v[2] = location.z;
+    v[3] = location.Pitch;
+    v[4] = location.Yaw;
+    v[5] = location.Roll;
+}
+
+SpatialLocation PoseFilter::fromArray(const double *v) {
+    return SpatialLocation((float) v[0], (float) v[1], (float) v[2], (float) v[3], (float) v[4], (float) v[5]);
+}
+
+cv::Matx33d PoseFilter::transition(double dt) const {
+    double a = model == CONSTANT_ACCELERATION ? dt * dt / 2 : 0;
+    return cv::Matx33d(1, dt, a,
+                       0, 1, model == CONSTANT_ACCELERATION ? dt : 0,
+                       0, 0, model == CONSTANT_ACCELERATION ? 1 : 0);
+}
+
+cv::Matx33d PoseFilter::processNoise(double dt, double q) const {
+    double dt2 = dt * dt, dt3 = dt2 * dt;
+    if (model == CONSTANT_VELOCITY)
+        return q * cv::Matx33d(dt3 / 3, dt2 / 2, 0,
+                               dt2 / 2, dt, 0,
+                               0, 0, 0);
+    double dt4 = dt3 * dt, dt5 = dt4 * dt;
+    return q * cv::Matx33d(dt5 / 20, dt4 / 8, dt3 / 6,
+                           dt4 / 8, dt3 / 3, dt2 / 2,
+                           dt3 / 6, dt2 / 2, dt);
+}
+
+SpatialLocation PoseFilter::update(const SpatialLocation &measurement, double timestamp) {
+    double z[AXES];
+    toArray(measurement, z);
+    double dt = timestamp - this->timestamp;
+    if (!initialized || dt < 0 || dt > resetInterval) {
+        // 以测量值为初值，速度、加速度未知
+        for (int i = 0; i < AXES; i++) {
+            axes[i].x = cv::Vec3d(z[i], 0, 0);
+            axes[i].P = cv::Matx33d(r[i], 0, 0,
+                                    0, r[i] / (resetInterval * resetInterval), 0,
+                                    0, 0, 0);
+            if (model == CONSTANT_ACCELERATION)
+                axes[i].P(2, 2) = axes[i].P(1, 1) / (resetInterval * resetInterval);
+        }
+        this->timestamp = timestamp;
+        initialized = true;
+        return measurement;
+    }
+
+    const cv::Matx33d F = transition(dt);
+    double v[AXES];
+    for (int i = 0; i < AXES; i++) {
+        Axis &a = axes[i];
+        // 预测
+        a.x = F * a.x;
+        a.P = F * a.P * F.t() + processNoise(dt, q[i]);
+        // 更新，观测矩阵为[1, 0, 0]
+        double S = a.P(0, 0) + r[i];
+        cv::Vec3d K(a.P(0, 0) / S, a.P(1, 0) / S, a.P(2, 0) / S);
+        double y = z[i] - a.x[0];
+        a.x += K * y;
+        cv::Matx13d H0(a.P(0, 0), a.P(0, 1), a.P(0, 2));
+        a.P -= cv::Matx31d(K[0], K[1], K[2]) * H0;
+        v[i] = a.x[0];
+    }
+    this->timestamp = timestamp;
+    return fromArray(v);
+}
+
+SpatialLocation PoseFilter::predict(double timestamp) const {
+    if (!initialized)
+        return SpatialLocation();
+    double dt = timestamp - this->timestamp;
+    double a = model == CONSTANT_ACCELERATION ? dt * dt / 2 : 0;
+    double v[AXES];
+    for (int i = 0; i < AXES; i++)
+        v[i] = axes[i].x[0] + axes[i].x[1] * dt + axes[i].x[2] * a;
+    return fromArray(v);
+}
+
+SpatialLocation PoseFilter::velocity() const {
+    double v[AXES] = {};
+    if (initialized) {
+        for (int i = 0; i < AXES; i++)
+            v[i] = axes[i].x[1];
+    }
+    return fromArray(v);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file ROITracker.cpp
+ */
+
+#include "ROITracker.h"
+
+ROITracker::ROITracker(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb, float margin, int minSize) :
+        offset(offset), lowerb(lowerb), upperb(upperb), margin(margin), minSize(minSize) {}
+
+void ROITracker::setThreshold(int offset, const cv::Scalar &lowerb, const cv::Scalar &upperb) {
+    this->offset = offset;
+    this->lowerb = lowerb;
+    this->upperb = upperb;
+}
+
+void ROITracker::reset() {
+    predicted = cv::Rect();
+    tracking = false;
+}
+
+bool ROITracker::detectIn(const cv::Mat &hsv, const cv::Rect &area, const Detector &detect, cv::Mat &mask,
+                          cv::Rect &target) const {
+    HChannleOffsetInRange(hsv(area), offset, lowerb, upperb, mask);
+    if (!detect(mask, target))
+        return false;
+    target += area.tl();
+    return true;
+}
+
+void ROITracker::update(const cv::Rect &target, const cv::Rect &frame) {
+    cv::Point2f center(target.x + target.width / 2.0f, target.y + target.height / 2.0f);
+    velocity = tracking ? center - lastCenter : cv::Point2f(0, 0);
+    lastCenter = center;
+    tracking = true;
+
+    // 按匀速外推中心，每边扩展margin倍目标尺寸，并覆盖一帧的位移
+    cv::Point2f next = center + velocity;
+    float w = std::max<float>(target.width * (1 + 2 * margin) + 2 * std::fabs(velocity.x), (float) minSize);
+    float h = std::max<float>(target.height * (1 + 2 * margin) + 2 * std::fabs(velocity.y), (float) minSize);
+    predicted = cv::Rect(cvFloor(next.x - w / 2), cvFloor(next.y - h / 2), cvCeil(w), cvCeil(h)) & frame;
+}
+
+bool ROITracker::process(const cv::Mat &hsv, const Detector &detect, cv::Mat &mask, cv::Rect &roi) {
+    const cv::Rect frame(0, 0, hsv.cols, hsv.rows);
+    cv::Rect target;
+    stat.frames++;
+    // 预测框按上一帧尺寸裁剪，分辨率变化时需再与当前帧求交
+    roi = predicted & frame;
+    if (tracking && roi.area() > 0 && roi != frame) {
+        if (detectIn(hsv, roi, detect, mask, target)) {
+            stat.roiHits++;
+            update(target, frame);
+            return true;
+        }
+    }
+    // 没有预测或ROI中丢失，同一帧内处理整幅图像
+    stat.fullFrames++;
+    roi = frame;
+    if (detectIn(hsv, roi, detect, mask, target)) {
+        update(target, frame);
+        return true;
+    }
+    stat.misses++;
+    reset();
+    return false;
+}
@@ -25,7 +25,8 @@ Sphe_COORD Sphe_COORD::operator=(const Rect_COORD &R2S) {
 }
 
 float Rect_COORD::distence(const Rect_COORD &A, const Rect_COORD &B) {
-    return sqrt(pow(A.x - B.x, 2) + pow(A.y - B.y, 2) + pow(A.z - B.z, 2));
+    float dx = A.x - B.x, dy = A.y - B.y, dz = A.z - B.z;
+    return sqrt(dx * dx + dy * dy + dz * dz);
 }
 
 Rect_COORD Rect_COORD::operator=(const Sphe_COORD &S2R) {
@@ -0,0 +1,93 @@
+/**
+ * @file main.cpp
+ * @brief CRC吞吐基准，对比原有的逐字节查表实现与当前的切片查表、无进位乘法折叠实现，
+ *        覆盖8B到1MB的数据长度，同时校验结果一致
+ */
+
+#include <CRC.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+
+/**
+ * 原有的逐字节查表实现，作为对照
+ */
+static uint8_t LegacyCRC8(const uint8_t *p, uint32_t len, uint8_t crc) {
+    while (len--)
+        crc = CRC::CRC8::table.v[crc ^ *p++];
+    return crc;
+}
+
+static uint16_t LegacyCRC16(const uint8_t *p, uint32_t len, uint16_t crc) {
+    while (len--)
+        crc = (uint16_t) ((crc >> 8) ^ CRC::CRC16::table.v[(crc ^ *p++) & 0xff]);
+    return crc;
+}
+
+static uint32_t LegacyCRC32(const uint8_t *p, uint32_t len, uint32_t crc) {
+    while (len--)
+        crc = (crc >> 8) ^ CRC::CRC32::table.v[(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+/**
+ * 运行一项测试
+ * @param len 每次计算的字节数
+ * @param totalBytes 总计算字节数，决定迭代次数
+ * @param fun 被测函数，返回值参与累加防止被优化掉
+ * @param sink 累加结果
+ * @return 吞吐量，单位GB/s
+ */
+static double measure(size_t len, size_t totalBytes, const std::function<uint32_t()> &fun, uint32_t &sink) {
+    size_t iterations = std::max<size_t>(1, totalBytes / len);
+    sink += fun();
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        sink += fun();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return (double) iterations * len / seconds / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    size_t totalBytes = (argc > 1 ? std::max(1, atoi(argv[1])) : 256) * (size_t) 1024 * 1024;
+    const size_t sizes[] = {8, 64, 256, 4096, 65536, 1024 * 1024};
+    /* 错开1字节，测试非对齐输入 */
+    std::vector<uint8_t> buffer(sizes[5] + 1);
+    std::mt19937 rng(0x5a);
+    for (auto &b : buffer)
+        b = (uint8_t) rng();
+    const uint8_t *data = buffer.data() + 1;
+
+    spdlog::info("{} MB per test, throughput in GB/s", totalBytes / 1024 / 1024);
+    spdlog::info("{:>8}  {:>9} {:>9}  {:>9} {:>9}  {:>9} {:>9}",
+                 "bytes", "crc8 old", "new", "crc16 old", "new", "crc32 old", "new");
+    uint32_t sink = 0;
+    bool mismatch = false;
+    for (size_t len : sizes) {
+        auto n = (uint32_t) len;
+        mismatch |= LegacyCRC8(data, n, 0xff) != CRC::Get_CRC8_Check_Sum(data, n, 0xff);
+        mismatch |= LegacyCRC16(data, n, 0xffff) != CRC::Get_CRC16_Check_Sum(data, n, 0xffff);
+        mismatch |= LegacyCRC32(data, n, 0xffffffff) != CRC::Get_CRC32_Check_Sum(data, n, 0xffffffff);
+
+        double crc8Old = measure(len, totalBytes, [&]() { return LegacyCRC8(data, n, 0xff); }, sink);
+        double crc8 = measure(len, totalBytes, [&]() { return CRC::Get_CRC8_Check_Sum(data, n, 0xff); }, sink);
+        double crc16Old = measure(len, totalBytes, [&]() { return LegacyCRC16(data, n, 0xffff); }, sink);
+        double crc16 = measure(len, totalBytes, [&]() { return CRC::Get_CRC16_Check_Sum(data, n, 0xffff); }, sink);
+        double crc32Old = measure(len, totalBytes, [&]() { return LegacyCRC32(data, n, 0xffffffff); }, sink);
+        double crc32 = measure(len, totalBytes, [&]() {
+            return CRC::Get_CRC32_Check_Sum(data, n, 0xffffffff);
+        }, sink);
+        spdlog::info("{:>8}  {:9.2f} {:9.2f}  {:9.2f} {:9.2f}  {:9.2f} {:9.2f}",
+                     len, crc8Old, crc8, crc16Old, crc16, crc32Old, crc32);
+    }
+    spdlog::debug("sink {}", sink);
+    if (mismatch) {
+        spdlog::error("result mismatch");
+        return 1;
+    }
+    spdlog::info("results match");
+    return 0;
+}
@@ -10,9 +10,119 @@
 
 #include <vector>
 #include <stdint.h>
+#include <stddef.h>
 #include <QByteArray>
 
 namespace CRC {
+    namespace detail {
+        template<typename T>
+        struct Table {
+            T v[256];
+        };
+
+        template<typename T>
+        constexpr T reflect(T val, int width) {
+            T ret = 0;
+            for (int i = 0; i < width; i++)
+                if (val & ((T) 1 << i))
+                    ret |= (T) 1 << (width - 1 - i);
+            return ret;
+        }
+
+        template<typename T, int Width, T Poly, bool Reflect>
+        constexpr Table<T> makeTable() {
+            Table<T> t{};
+            const T mask = (T) (~(T) 0 >> (sizeof(T) * 8 - Width));
+            for (unsigned i = 0; i < 256; i++) {
+                T c = 0;
+                if (Reflect) {
+                    c = (T) i;
+                    for (int k = 0; k < 8; k++)
+                        c = (c & 1) ? (T) ((c >> 1) ^ reflect(Poly, Width)) : (T) (c >> 1);
+                } else {
+                    c = (T) ((T) i << (Width - 8));
+                    for (int k = 0; k < 8; k++)
+                        c = (c & ((T) 1 << (Width - 1))) ? (T) (((c << 1) ^ Poly) & mask) : (T) ((c << 1) & mask);
+                }
+                t.v[i] = c;
+            }
+            return t;
+        }
+    }
+
+    /**
+     * @brief 编译期生成查表的CRC引擎
+     * @details 参数与CRC参数目录(RevEng catalogue)一致，输入输出同时反射或同时不反射，
+     *          查表在编译期生成，常量输入可在编译期求值，例如
+     *          {@code static_assert(CRC::CRC32::compute("123456789") == 0xCBF43926, "");}
+     *          依赖C++14的constexpr，Qt_Util目标已通过target_compile_features传递该要求
+     * @tparam T 寄存器类型
+     * @tparam Width 位宽，8~寄存器位数
+     * @tparam Poly 生成多项式，不含最高位，正常位序
+     * @tparam Init 初值，正常位序
+     * @tparam Reflect 输入输出是否反射
+     * @tparam XorOut 结果异或值
+     */
+    template<typename T, int Width, T Poly, T Init, bool Reflect, T XorOut>
+    struct Engine {
+        static_assert(Width >= 8 && Width <= (int) sizeof(T) * 8, "CRC width out of range");
+
+        using value_type = T;
+
+        static constexpr T mask = (T) (~(T) 0 >> (sizeof(T) * 8 - Width));
+
+        static constexpr detail::Table<T> table = detail::makeTable<T, Width, Poly, Reflect>();    //!<@brief 单字节查表
+
+        /**
+         * @brief 寄存器初值，反射算法为反射后的值
+         */
+        static constexpr T init() {
+            return Reflect ? detail::reflect(Init, Width) : Init;
+        }
+
+        /**
+         * @brief 逐字节更新寄存器，编译期可用，运行期大数据应使用CRC.cpp中的加速版本
+         */
+        template<typename C>
+        static constexpr T update(T crc, const C *p, size_t len) {
+            for (size_t i = 0; i < len; i++) {
+                uint8_t b = (uint8_t) p[i];
+                if (Reflect)
+                    crc = (T) ((crc >> 8) ^ table.v[(crc ^ b) & 0xff]);
+                else
+                    crc = (T) (((crc << 8) ^ table.v[((crc >> (Width - 8)) ^ b) & 0xff]) & mask);
+            }
+            return crc;
+        }
+
+        static constexpr T finalize(T crc) {
+            return (T) (crc ^ XorOut);
+        }
+
+        template<typename C>
+        static constexpr T compute(const C *p, size_t len) {
+            return finalize(update(init(), p, len));
+        }
+
+        /**
+         * @brief 计算字符串常量的CRC，不含结尾的'\0'
+         */
+        template<size_t N>
+        static constexpr T compute(const char (&str)[N]) {
+            return compute(str, N - 1);
+        }
+    };
+
+    template<typename T, int Width, T Poly, T Init, bool Reflect, T XorOut>
+    constexpr detail::Table<T> Engine<T, Width, Poly, Init, Reflect, XorOut>::table;
+
+    template<typename T, int Width, T Poly, T Init, bool Reflect, T XorOut>
+    constexpr T Engine<T, Width, Poly, Init, Reflect, XorOut>::mask;
+
+    using CRC8 = Engine<uint8_t, 8, 0x31, 0xff, true, 0x00>;                        //!<@brief 裁判系统CRC8
+    using CRC16 = Engine<uint16_t, 16, 0x1021, 0xffff, true, 0x0000>;               //!<@brief 裁判系统CRC16，即CRC-16/MCRF4XX
+    using CRC32 = Engine<uint32_t, 32, 0x04C11DB7, 0xffffffff, true, 0xffffffff>;   //!<@brief CRC-32/ISO-HDLC
+
     /**
      * @brief Descriptions: CRC8 checksum function
      * @param pchMessage Data to check
@@ -20,7 +130,7 @@ namespace CRC {
      * @param wCRC initialized checksum
      * @return CRC checksum
      */
-    uint8_t Get_CRC8_Check_Sum(uint8_t *pchMessage, uint8_t dwLength, uint8_t ucCRC8);
+    uint8_t Get_CRC8_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint8_t ucCRC8);
 
     /**
      * @brief Descriptions: CRC16 checksum function
@@ -29,7 +139,7 @@ namespace CRC {
      * @param wCRC initialized checksum
      * @return CRC checksum
      */
-    uint16_t Get_CRC16_Check_Sum(uint8_t *pchMessage, uint32_t dwLength, uint16_t wCRC);
+    uint16_t Get_CRC16_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint16_t wCRC);
 
     /**
      * @brief Descriptions: CRC8 Verify function
@@ -37,15 +147,15 @@ namespace CRC {
      * @param dwLength Stream length = Data + checksum
      * @return CRC Verify Result
      */
-    uint8_t Verify_CRC8_Check_Sum(uint8_t *pchMessage, uint8_t dwLength);
+    uint8_t Verify_CRC8_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength);
 
     /**
      * overloaded function
      * @param pchMessage Data to Verify
      * @return CRC Verify Result
      */
-    inline uint8_t Verify_CRC8_Check_Sum(std::vector<uint8_t> pchMessage) {
-        return Verify_CRC8_Check_Sum(pchMessage.data(), (uint8_t) pchMessage.size());
+    inline uint8_t Verify_CRC8_Check_Sum(const std::vector<uint8_t> &pchMessage) {
+        return Verify_CRC8_Check_Sum(pchMessage.data(), (uint32_t) pchMessage.size());
     }
 
     /**
@@ -54,7 +164,7 @@ namespace CRC {
      * @return CRC Verify Result
      */
     inline uint8_t Verify_CRC8_Check_Sum(const QByteArray &pchMessage) {
-        return Verify_CRC8_Check_Sum((uint8_t *)pchMessage.data(), (uint8_t) pchMessage.size());
+        return Verify_CRC8_Check_Sum((const uint8_t *) pchMessage.constData(), (uint32_t) pchMessage.size());
     }
 
     /**
@@ -63,15 +173,15 @@ namespace CRC {
      * @param dwLength Stream length = Data + checksum
      * @return CRC Verify Result
      */
-    uint16_t Verify_CRC16_Check_Sum(uint8_t *pchMessage, uint32_t dwLength);
+    uint16_t Verify_CRC16_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength);
 
     /**
      * overloaded function
      * @param pchMessage Data to Verify
      * @return CRC Verify Result
      */
-    inline uint16_t Verify_CRC16_Check_Sum(std::vector<uint8_t> pchMessage) {
-        return Verify_CRC16_Check_Sum(pchMessage.data(), (uint8_t) pchMessage.size());
+    inline uint16_t Verify_CRC16_Check_Sum(const std::vector<uint8_t> &pchMessage) {
+        return Verify_CRC16_Check_Sum(pchMessage.data(), (uint32_t) pchMessage.size());
     }
 
     /**
@@ -80,8 +190,96 @@ namespace CRC {
      * @return CRC Verify Result
      */
     inline uint16_t Verify_CRC16_Check_Sum(const QByteArray &pchMessage) {
-        return Verify_CRC16_Check_Sum((uint8_t *)pchMessage.data(), (uint8_t) pchMessage.size());
+        return Verify_CRC16_Check_Sum((const uint8_t *) pchMessage.constData(), (uint32_t) pchMessage.size());
     }
+
+    /**
+     * @brief Descriptions: CRC32 checksum function
+     * @param pchMessage Data to check
+     * @param dwLength Stream length
+     * @param dwCRC initialized checksum, register value without final xor
+     * @return CRC register value without final xor
+     */
+    uint32_t Get_CRC32_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint32_t dwCRC);
+
+    /**
+     * @brief CRC32 Verify function
+     * @param pchMessage Data to Verify
+     * @param dwLength Stream length
+     * @return CRC Verify Result
+     */
+    uint32_t Verify_CRC32_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength);
+
+    /**
+     * overloaded function
+     * @param pchMessage Data to Verify
+     * @return CRC Verify Result
+     */
+    inline uint32_t Verify_CRC32_Check_Sum(const QByteArray &pchMessage) {
+        return Verify_CRC32_Check_Sum((const uint8_t *) pchMessage.constData(), (uint32_t) pchMessage.size());
+    }
+
+    namespace detail {
+        /**
+         * @brief 通用引擎逐字节更新，CRC8、CRC16、CRC32使用下面的加速重载
+         */
+        template<typename E>
+        inline typename E::value_type update(const E *, typename E::value_type crc, const uint8_t *p, size_t len) {
+            return E::update(crc, p, len);
+        }
+
+        uint8_t update(const CRC8 *, uint8_t crc, const uint8_t *p, size_t len);
+
+        uint16_t update(const CRC16 *, uint16_t crc, const uint8_t *p, size_t len);
+
+        uint32_t update(const CRC32 *, uint32_t crc, const uint8_t *p, size_t len);
+    }
+
+    /**
+     * @brief 流式CRC计算
+     * @details 数据可分多次送入，不拷贝数据，长度不受限制，结果与一次性计算相同，例如
+     *          {@code
+     *          CRC::Context<CRC::CRC16> ctx;
+     *          ctx.update(head, sizeof(head)).update(payload);
+     *          uint16_t crc = ctx.final();}
+     * @tparam E CRC引擎，如CRC8、CRC16、CRC32
+     */
+    template<typename E>
+    class Context {
+        typename E::value_type crc;
+
+    public:
+        using value_type = typename E::value_type;
+
+        Context() : crc(E::init()) {}
+
+        /**
+         * @brief 重新开始计算
+         */
+        inline void init() {
+            crc = E::init();
+        }
+
+        inline Context &update(const void *data, size_t len) {
+            crc = detail::update((const E *) nullptr, crc, (const uint8_t *) data, len);
+            return *this;
+        }
+
+        inline Context &update(const QByteArray &data) {
+            return update(data.constData(), data.size());
+        }
+
+        inline Context &update(const std::vector<uint8_t> &data) {
+            return update(data.data(), data.size());
+        }
+
+        /**
+         * @brief 获取结果，不影响继续送入数据
+         */
+        inline value_type final() const {
+            return E::finalize(crc);
+        }
+    };
 }
 
 
@@ -6,91 +6,315 @@
 
 #include "CRC.h"
 
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC_PCLMUL
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define CRC_PMULL
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 namespace CRC {
-    static const uint8_t CRC8_INIT = 0xff;
-    static const uint16_t CRC_INIT = 0xffff;
-
-    static const uint8_t CRC8_TAB[256] = {
-            0x00, 0x5e, 0xbc, 0xe2, 0x61, 0x3f, 0xdd, 0x83, 0xc2, 0x9c, 0x7e, 0x20, 0xa3, 0xfd, 0x1f, 0x41,
-            0x9d, 0xc3, 0x21, 0x7f, 0xfc, 0xa2, 0x40, 0x1e, 0x5f, 0x01, 0xe3, 0xbd, 0x3e, 0x60, 0x82, 0xdc,
-            0x23, 0x7d, 0x9f, 0xc1, 0x42, 0x1c, 0xfe, 0xa0, 0xe1, 0xbf, 0x5d, 0x03, 0x80, 0xde, 0x3c, 0x62,
-            0xbe, 0xe0, 0x02, 0x5c, 0xdf, 0x81, 0x63, 0x3d, 0x7c, 0x22, 0xc0, 0x9e, 0x1d, 0x43, 0xa1, 0xff,
-            0x46, 0x18, 0xfa, 0xa4, 0x27, 0x79, 0x9b, 0xc5, 0x84, 0xda, 0x38, 0x66, 0xe5, 0xbb, 0x59, 0x07,
-            0xdb, 0x85, 0x67, 0x39, 0xba, 0xe4, 0x06, 0x58, 0x19, 0x47, 0xa5, 0xfb, 0x78, 0x26, 0xc4, 0x9a,
-            0x65, 0x3b, 0xd9, 0x87, 0x04, 0x5a, 0xb8, 0xe6, 0xa7, 0xf9, 0x1b, 0x45, 0xc6, 0x98, 0x7a, 0x24,
-            0xf8, 0xa6, 0x44, 0x1a, 0x99, 0xc7, 0x25, 0x7b, 0x3a, 0x64, 0x86, 0xd8, 0x5b, 0x05, 0xe7, 0xb9,
-            0x8c, 0xd2, 0x30, 0x6e, 0xed, 0xb3, 0x51, 0x0f, 0x4e, 0x10, 0xf2, 0xac, 0x2f, 0x71, 0x93, 0xcd,
-            0x11, 0x4f, 0xad, 0xf3, 0x70, 0x2e, 0xcc, 0x92, 0xd3, 0x8d, 0x6f, 0x31, 0xb2, 0xec, 0x0e, 0x50,
-            0xaf, 0xf1, 0x13, 0x4d, 0xce, 0x90, 0x72, 0x2c, 0x6d, 0x33, 0xd1, 0x8f, 0x0c, 0x52, 0xb0, 0xee,
-            0x32, 0x6c, 0x8e, 0xd0, 0x53, 0x0d, 0xef, 0xb1, 0xf0, 0xae, 0x4c, 0x12, 0x91, 0xcf, 0x2d, 0x73,
-            0xca, 0x94, 0x76, 0x28, 0xab, 0xf5, 0x17, 0x49, 0x08, 0x56, 0xb4, 0xea, 0x69, 0x37, 0xd5, 0x8b,
-            0x57, 0x09, 0xeb, 0xb5, 0x36, 0x68, 0x8a, 0xd4, 0x95, 0xcb, 0x29, 0x77, 0xf4, 0xaa, 0x48, 0x16,
-            0xe9, 0xb7, 0x55, 0x0b, 0x88, 0xd6, 0x34, 0x6a, 0x2b, 0x75, 0x97, 0xc9, 0x4a, 0x14, 0xf6, 0xa8,
-            0x74, 0x2a, 0xc8, 0x96, 0x15, 0x4b, 0xa9, 0xf7, 0xb6, 0xe8, 0x0a, 0x54, 0xd7, 0x89, 0x6b, 0x35,
+    /**
+     * @brief 切片表，tab[k][i]为字节i后跟k个0字节的CRC，由单字节表推导，结果与逐字节查表完全一致
+     */
+    template<typename T>
+    struct SliceTable {
+        T tab[8][256];
+
+        explicit SliceTable(const T *base) {
+            for (int i = 0; i < 256; i++)
+                tab[0][i] = base[i];
+            for (int k = 1; k < 8; k++)
+                for (int i = 0; i < 256; i++)
+                    tab[k][i] = (T) ((tab[k - 1][i] >> 8) ^ base[tab[k - 1][i] & 0xff]);
+        }
     };
 
-    static const uint16_t wCRC_Table[256] = {
-            0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
-            0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
-            0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
-            0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
-            0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
-            0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
-            0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
-            0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
-            0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
-            0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
-            0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
-            0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
-            0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
-            0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
-            0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
-            0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
-            0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
-            0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
-            0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
-            0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
-            0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
-            0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
-            0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
-            0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
-            0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
-            0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
-            0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
-            0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
-            0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
-            0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
-            0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
-            0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
+    static const SliceTable<uint8_t> &crc8Slice() {
+        static const SliceTable<uint8_t> table(CRC8::table.v);
+        return table;
+    }
+
+    static const SliceTable<uint16_t> &crc16Slice() {
+        static const SliceTable<uint16_t> table(CRC16::table.v);
+        return table;
+    }
+
+    static const SliceTable<uint32_t> &crc32Slice() {
+        static const SliceTable<uint32_t> table(CRC32::table.v);
+        return table;
+    }
+
+    /**
+     * @brief 反射CRC的slicing-by-8，每次处理8字节
+     */
+    template<typename T>
+    static T sliceBy8(const SliceTable<T> &t, const uint8_t *p, size_t len, T crc) {
+        while (len >= 8) {
+            uint32_t lo = ((uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24) ^ crc;
+            uint32_t hi = (uint32_t) p[4] | (uint32_t) p[5] << 8 | (uint32_t) p[6] << 16 | (uint32_t) p[7] << 24;
+            crc = t.tab[7][lo & 0xff] ^ t.tab[6][(lo >> 8) & 0xff] ^ t.tab[5][(lo >> 16) & 0xff] ^ t.tab[4][lo >> 24] ^
+                  t.tab[3][hi & 0xff] ^ t.tab[2][(hi >> 8) & 0xff] ^ t.tab[1][(hi >> 16) & 0xff] ^ t.tab[0][hi >> 24];
+            p += 8;
+            len -= 8;
+        }
+        while (len--)
+            crc = (T) ((crc >> 8) ^ t.tab[0][(crc ^ *p++) & 0xff]);
+        return crc;
+    }
+
+#if defined(CRC_PCLMUL) || defined(CRC_PMULL)
+    /**
+     * @brief 无进位乘法折叠常数
+     * @details 16字节块按小端读入时第i位对应x^(127-i)，两个64位反射数无进位相乘的结果再乘x即对齐到128位块，
+     *          所以向后折叠n位使用x^(n+63)和x^(n-1)对P取模后的64位反射值
+     */
+    struct FoldConstants {
+        uint64_t k128[2];   //!<@brief 折叠128位
+        uint64_t k512[2];   //!<@brief 折叠512位，四路并行
     };
 
-    uint8_t Get_CRC8_Check_Sum(uint8_t *pchMessage, uint8_t dwLength, uint8_t ucCRC8) {
-        uint8_t ucIndex;
-        while (dwLength--) {
-            ucIndex = ucCRC8 ^ (*pchMessage++);
-            ucCRC8 = CRC8_TAB[ucIndex];
+    /**
+     * @brief 计算x^n mod P的64位反射值
+     * @param poly 不含最高位的生成多项式，正常位序
+     * @param width CRC位宽
+     */
+    static uint64_t xPowModReflected(uint32_t poly, int width, int n) {
+        uint64_t top = 1ull << width, r = 1;
+        for (int i = 0; i < n; i++) {
+            r <<= 1;
+            if (r & top)
+                r ^= top | poly;
+        }
+        uint64_t ret = 0;
+        for (int i = 0; i < width; i++)
+            if (r & (1ull << i))
+                ret |= 1ull << (63 - i);
+        return ret;
+    }
+
+    static FoldConstants makeFoldConstants(uint32_t poly, int width) {
+        FoldConstants k = {};
+        k.k128[0] = xPowModReflected(poly, width, 128 + 63);
+        k.k128[1] = xPowModReflected(poly, width, 128 - 1);
+        k.k512[0] = xPowModReflected(poly, width, 512 + 63);
+        k.k512[1] = xPowModReflected(poly, width, 512 - 1);
+        return k;
+    }
+
+    static const FoldConstants &crc16Fold() {
+        static const FoldConstants k = makeFoldConstants(0x1021, 16);
+        return k;
+    }
+
+    static const FoldConstants &crc32Fold() {
+        static const FoldConstants k = makeFoldConstants(0x04C11DB7, 32);
+        return k;
+    }
+
+    static const FoldConstants &crc8Fold() {
+        static const FoldConstants k = makeFoldConstants(0x31, 8);
+        return k;
+    }
+
+    /** @brief 使用折叠的最短长度，短数据切片查表更快 */
+    static const size_t FOLD_MIN_LEN = 64;
+#endif
+
+#ifdef CRC_PCLMUL
+    __attribute__((target("pclmul,sse2")))
+    static inline __m128i fold(__m128i x, __m128i k) {
+        return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+    }
+
+    /**
+     * @brief 把len(>=FOLD_MIN_LEN)字节中16字节对齐的部分折叠为16字节，init异或到开头
+     * @return 已处理的字节数
+     */
+    __attribute__((target("pclmul,sse2")))
+    static size_t foldBlocks(const FoldConstants &k, const uint8_t *p, size_t len, uint32_t init, uint8_t out[16]) {
+        const uint8_t *begin = p;
+        __m128i k128 = _mm_loadu_si128((const __m128i *) k.k128);
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) p), _mm_cvtsi32_si128((int) init));
+        p += 16;
+        len -= 16;
+        if (len >= 112) {
+            __m128i k512 = _mm_loadu_si128((const __m128i *) k.k512);
+            __m128i x1 = _mm_loadu_si128((const __m128i *) p);
+            __m128i x2 = _mm_loadu_si128((const __m128i *) (p + 16));
+            __m128i x3 = _mm_loadu_si128((const __m128i *) (p + 32));
+            p += 48;
+            len -= 48;
+            while (len >= 64) {
+                x = _mm_xor_si128(fold(x, k512), _mm_loadu_si128((const __m128i *) p));
+                x1 = _mm_xor_si128(fold(x1, k512), _mm_loadu_si128((const __m128i *) (p + 16)));
+                x2 = _mm_xor_si128(fold(x2, k512), _mm_loadu_si128((const __m128i *) (p + 32)));
+                x3 = _mm_xor_si128(fold(x3, k512), _mm_loadu_si128((const __m128i *) (p + 48)));
+                p += 64;
+                len -= 64;
+            }
+            x = _mm_xor_si128(fold(x, k128), x1);
+            x = _mm_xor_si128(fold(x, k128), x2);
+            x = _mm_xor_si128(fold(x, k128), x3);
+        }
+        while (len >= 16) {
+            x = _mm_xor_si128(fold(x, k128), _mm_loadu_si128((const __m128i *) p));
+            p += 16;
+            len -= 16;
+        }
+        _mm_storeu_si128((__m128i *) out, x);
+        return p - begin;
+    }
+
+    static bool hasClmul() {
+        static const bool ret = __builtin_cpu_supports("pclmul");
+        return ret;
+    }
+#endif
+
+#ifdef CRC_PMULL
+    __attribute__((target("+crypto")))
+    static inline uint64x2_t fold(uint64x2_t x, uint64x2_t k) {
+        uint64x2_t lo = vreinterpretq_u64_p128(vmull_p64((poly64_t) vgetq_lane_u64(x, 0),
+                                                         (poly64_t) vgetq_lane_u64(k, 0)));
+        uint64x2_t hi = vreinterpretq_u64_p128(vmull_p64((poly64_t) vgetq_lane_u64(x, 1),
+                                                         (poly64_t) vgetq_lane_u64(k, 1)));
+        return veorq_u64(lo, hi);
+    }
+
+    __attribute__((target("+crypto")))
+    static inline uint64x2_t load(const uint8_t *p) {
+        return vreinterpretq_u64_u8(vld1q_u8(p));
+    }
+
+    /**
+     * @brief 同PCLMUL版本
+     */
+    __attribute__((target("+crypto")))
+    static size_t foldBlocks(const FoldConstants &k, const uint8_t *p, size_t len, uint32_t init, uint8_t out[16]) {
+        const uint8_t *begin = p;
+        uint64x2_t k128 = vld1q_u64(k.k128);
+        uint64x2_t x = veorq_u64(load(p), vsetq_lane_u64(init, vdupq_n_u64(0), 0));
+        p += 16;
+        len -= 16;
+        if (len >= 112) {
+            uint64x2_t k512 = vld1q_u64(k.k512);
+            uint64x2_t x1 = load(p), x2 = load(p + 16), x3 = load(p + 32);
+            p += 48;
+            len -= 48;
+            while (len >= 64) {
+                x = veorq_u64(fold(x, k512), load(p));
+                x1 = veorq_u64(fold(x1, k512), load(p + 16));
+                x2 = veorq_u64(fold(x2, k512), load(p + 32));
+                x3 = veorq_u64(fold(x3, k512), load(p + 48));
+                p += 64;
+                len -= 64;
+            }
+            x = veorq_u64(fold(x, k128), x1);
+            x = veorq_u64(fold(x, k128), x2);
+            x = veorq_u64(fold(x, k128), x3);
+        }
+        while (len >= 16) {
+            x = veorq_u64(fold(x, k128), load(p));
+            p += 16;
+            len -= 16;
+        }
+        vst1q_u8(out, vreinterpretq_u8_u64(x));
+        return p - begin;
+    }
+
+    static bool hasClmul() {
+        static const bool ret = (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+        return ret;
+    }
+#endif
+
+    /**
+     * @brief 计算反射CRC，长数据且CPU支持时先用无进位乘法折叠，再切片查表处理折叠结果和剩余数据
+     */
+    static uint8_t crc8(const uint8_t *p, size_t len, uint8_t crc) {
+#if defined(CRC_PCLMUL) || defined(CRC_PMULL)
+        if (len >= FOLD_MIN_LEN && hasClmul()) {
+            uint8_t folded[16];
+            size_t done = foldBlocks(crc8Fold(), p, len, crc, folded);
+            crc = sliceBy8(crc8Slice(), folded, 16, (uint8_t) 0);
+            return sliceBy8(crc8Slice(), p + done, len - done, crc);
+        }
+#endif
+        return sliceBy8(crc8Slice(), p, len, crc);
+    }
+
+    static uint16_t crc16(const uint8_t *p, size_t len, uint16_t crc) {
+#if defined(CRC_PCLMUL) || defined(CRC_PMULL)
+        if (len >= FOLD_MIN_LEN && hasClmul()) {
+            uint8_t folded[16];
+            size_t done = foldBlocks(crc16Fold(), p, len, crc, folded);
+            crc = sliceBy8(crc16Slice(), folded, 16, (uint16_t) 0);
+            return sliceBy8(crc16Slice(), p + done, len - done, crc);
+        }
+#endif
+        return sliceBy8(crc16Slice(), p, len, crc);
+    }
+
+    static uint32_t crc32(const uint8_t *p, size_t len, uint32_t crc) {
+#if defined(CRC_PCLMUL) || defined(CRC_PMULL)
+        if (len >= FOLD_MIN_LEN && hasClmul()) {
+            uint8_t folded[16];
+            size_t done = foldBlocks(crc32Fold(), p, len, crc, folded);
+            crc = sliceBy8(crc32Slice(), folded, 16, (uint32_t) 0);
+            return sliceBy8(crc32Slice(), p + done, len - done, crc);
+        }
+#endif
+        return sliceBy8(crc32Slice(), p, len, crc);
+    }
+
+    namespace detail {
+        uint8_t update(const CRC8 *, uint8_t crc, const uint8_t *p, size_t len) {
+            return crc8(p, len, crc);
+        }
+
+        uint16_t update(const CRC16 *, uint16_t crc, const uint8_t *p, size_t len) {
+            return crc16(p, len, crc);
+        }
+
+        uint32_t update(const CRC32 *, uint32_t crc, const uint8_t *p, size_t len) {
+            return crc32(p, len, crc);
         }
-        return (ucCRC8);
     }
 
-    uint8_t Verify_CRC8_Check_Sum(uint8_t *pchMessage, uint8_t dwLength) {
+    uint8_t Get_CRC8_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint8_t ucCRC8) {
+        return crc8(pchMessage, dwLength, ucCRC8);
+    }
+
+    uint8_t Verify_CRC8_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength) {
+        if (pchMessage == nullptr || dwLength == 0) return 0;
+        return Get_CRC8_Check_Sum(pchMessage, dwLength - 1, CRC8::init());
+    }
+
+    uint16_t Get_CRC16_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint16_t wCRC) {
+        if (pchMessage == nullptr)
+            return CRC16::init();
+        return crc16(pchMessage, dwLength, wCRC);
+    }
+
+    uint16_t Verify_CRC16_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength) {
         if (pchMessage == nullptr) return 0;
-        return Get_CRC8_Check_Sum(pchMessage, dwLength - 1, CRC8_INIT);
+        return Get_CRC16_Check_Sum(pchMessage, dwLength, CRC16::init());
     }
 
-    uint16_t Get_CRC16_Check_Sum(uint8_t *pchMessage, uint32_t dwLength, uint16_t wCRC) {
-        uint8_t chData;
+    uint32_t Get_CRC32_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength, uint32_t dwCRC) {
         if (pchMessage == nullptr)
-            return CRC_INIT;
-        while (dwLength--) {
-            chData = *pchMessage++;
-            (wCRC) = ((uint16_t) (wCRC) >> 8) ^ wCRC_Table[((uint16_t) (wCRC) ^ (uint16_t) (chData)) & 0x00ff];
-        }
-        return wCRC;
+            return CRC32::init();
+        return crc32(pchMessage, dwLength, dwCRC);
     }
 
-    uint16_t Verify_CRC16_Check_Sum(uint8_t *pchMessage, uint32_t dwLength) {
+    uint32_t Verify_CRC32_Check_Sum(const uint8_t *pchMessage, uint32_t dwLength) {
         if (pchMessage == nullptr) return 0;
-        return Get_CRC16_Check_Sum(pchMessage, dwLength, CRC_INIT);
+        return CRC32::finalize(Get_CRC32_Check_Sum(pchMessage, dwLength, CRC32::init()));
     }
 }
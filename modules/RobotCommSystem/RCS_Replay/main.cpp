@@ -0,0 +1,15 @@
+/**
+ * @file main.cpp
+ * @brief RCS流量回放工具主函数
+ */
+
+#include <QCoreApplication>
+#include "main.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("RCS_Replay");
+    MyMainThread myMainThread(app.arguments());
+    QObject::connect(&myMainThread, SIGNAL(threadExit()), &app, SLOT(quit()));
+    return app.exec();
+}
@@ -0,0 +1,135 @@
+#ifndef KDROBOTCPPLIBS_RCS_REPLAY_MAIN_H
+#define KDROBOTCPPLIBS_RCS_REPLAY_MAIN_H
+
+#include <spdlog/spdlog.h>
+#include <QCoreApplication>
+#include <RCS_Client.h>
+#include <RCS_Server.h>
+#include <RCS_Recorder.h>
+#include <spdlogger.h>
+#include <MainThread.h>
+
+/**
+ * 回放工具
+ * @brief 以记录中的客户端名连接服务器，按原始时间间隔或加速重新发送PUSH、GET、BROADCAST
+ * @note 目标服务器上不能已有同名客户端
+ */
+class MyMainThread : public MainThread {
+Q_OBJECT
+    RCS_RecordReader reader;
+    QMap<QString, RCS_Client *> clients;
+    double speed = 1;
+
+public:
+
+    MyMainThread(const QStringList &args, QObject *parent = nullptr) : MainThread(args, parent) {
+        QCommandLineParser parser;
+        QCommandLineOption log({"l", "log"}, "Set the log file path. default disable", "log");
+        QCommandLineOption file({"f", "file"}, "Record file to replay", "file");
+        QCommandLineOption address({"a", "address"}, "Server address, the default is 127.0.0.1", "address");
+        address.setDefaultValue("127.0.0.1");
+        QCommandLineOption TcpPort({"t", "TcpPort"}, "Set Tcp Port, the default is 8550", "TcpPort");
+        TcpPort.setDefaultValue("8550");
+        QCommandLineOption speedOption({"s", "speed"}, "Replay speed, 0 for as fast as possible, the default is 1",
+                                       "speed");
+        speedOption.setDefaultValue("1");
+        parser.addHelpOption();
+        parser.addOptions({log, file, address, TcpPort, speedOption});
+        parser.process(args);
+
+        QString logFile = parser.value(log);
+        if (!logFile.isEmpty()) {
+            spdlogger::allLogger_logToFile(logFile.toStdString());
+        }
+        spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [thread %t] [%^%-8l%$]: %v");
+
+        bool Ok;
+        uint16_t port = parser.value(TcpPort).toUShort(&Ok);
+        if (!Ok) {
+            logger.error("Tcp port input error");
+            exitOnError();
+            return;
+        }
+        speed = parser.value(speedOption).toDouble(&Ok);
+        if (!Ok || speed < 0) {
+            logger.error("speed input error");
+            exitOnError();
+            return;
+        }
+        if (!reader.open(parser.value(file))) {
+            exitOnError();
+            return;
+        }
+
+        /* 带有Qt信号量的对象在主线程构造 */
+        QHostAddress addr(parser.value(address));
+        for (int i = 0; i < reader.size(); i++) {
+            RCS_Record record = reader.at(i);
+            if (!replayable(record) || clients.contains(record.from))
+                continue;
+            auto client = new RCS_Client(record.from, addr, port, this);
+            if (!client->isConnected()) {
+                logger.error("client '{}' can't connect", record.from);
+                exitOnError();
+                return;
+            }
+            clients.insert(record.from, client);
+        }
+        this->start();
+    }
+
+protected:
+    /**
+     * 构造失败时线程不会启动，threadExit不会发出，需要直接退出事件循环
+     * @note 构造函数在app.exec()之前执行，排队到事件循环启动后再退出
+     */
+    static void exitOnError() {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), []() { QCoreApplication::exit(1); },
+                                  Qt::QueuedConnection);
+    }
+
+    static bool replayable(const RCS_Record &record) {
+        return record.from != RCS_Server::__NAME__ &&
+               (record.type == TcpConnect::PUSH || record.type == TcpConnect::GET ||
+                record.type == TcpConnect::BROADCAST);
+    }
+
+    void main(const QStringList &args) override {
+        if (reader.size() == 0)
+            return;
+        qint64 begin = reader.at(0).timestamp;
+        QElapsedTimer elapsedTimer;
+        elapsedTimer.start();
+        int count = 0;
+        for (int i = 0; i < reader.size() && running; i++) {
+            RCS_Record record = reader.at(i);
+            if (!replayable(record))
+                continue;
+            if (speed > 0) {
+                qint64 wait = (qint64) ((record.timestamp - begin) / speed) - elapsedTimer.nsecsElapsed() / 1000;
+                if (wait > 0)
+                    QThread::usleep(wait);
+            }
+            QJsonObject payload = QJsonDocument::fromJson(record.payload).object();
+            RCS_Client *client = clients.value(record.from);
+            switch (record.type) {
+                case TcpConnect::PUSH:
+                    client->PUSH(record.to, payload.value("var").toString(), payload.value("val").toObject());
+                    break;
+                case TcpConnect::GET:
+                    client->GET(record.to, payload.value("var").toString(), payload.value("info").toObject());
+                    break;
+                case TcpConnect::BROADCAST:
+                    client->BROADCAST(payload.value("bordcastName").toString(), payload.value("bordcast").toObject());
+                    break;
+                default:
+                    break;
+            }
+            count++;
+        }
+        double seconds = elapsedTimer.nsecsElapsed() / 1e9;
+        logger.info("replayed {} frames in {:.3f}s, {:.1f} frames/s", count, seconds, count / seconds);
+    }
+};
+
+#endif //KDROBOTCPPLIBS_RCS_REPLAY_MAIN_H
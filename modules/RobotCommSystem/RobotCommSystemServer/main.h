@@ -16,8 +16,16 @@ public:
         QCommandLineOption log({"l", "log"}, "Set the log file path. default disable", "log");
         QCommandLineOption TcpPort({"t", "TcpPort"}, "Set Tcp Port, the default is 8550", "TcpPort");
         TcpPort.setDefaultValue("8550");
+        QCommandLineOption heartbeat({"b", "heartbeat"},
+                                     "Set heartbeat interval in ms, 0 to disable, the default is 1000", "heartbeat");
+        heartbeat.setDefaultValue("1000");
+        QCommandLineOption name({"n", "name"}, "Set server name, must be unique among peers. default random", "name");
+        QCommandLineOption peer({"p", "peer"}, "Connect to peer server <host:port>, can be repeated", "peer");
+        QCommandLineOption record({"r", "record"}, "Record every routed frame to file. default disable", "record");
+        QCommandLineOption cache({"C", "cache"}, "Answer GET with published values not older than <ms>. default disable",
+                                 "cache");
         parser.addHelpOption();
-        parser.addOptions({noUdp, log, TcpPort});
+        parser.addOptions({noUdp, log, TcpPort, heartbeat, name, peer, record, cache});
         parser.process(args);
 
         QString logFile = parser.value("log");
@@ -52,14 +60,57 @@ public:
             }
         }
 
+        int heartbeatInterval = TcpConnect::DEFAULT_HEARTBEAT_INTERVAL;
+        if (parser.isSet(heartbeat)) {
+            bool Ok;
+            int t = parser.value(heartbeat).toInt(&Ok);
+            if (Ok) {
+                heartbeatInterval = t;
+                logger.info("set heartbeat interval {}ms", heartbeatInterval);
+            } else {
+                logger.error("heartbeat interval input error");
+                return;
+            }
+        }
+
         RCS_Server *server;
         try {
             server = new RCS_Server(port, !parser.isSet(noUdp));
-            (void) server;
+            server->setHeartbeat(heartbeatInterval);
         } catch (const std::runtime_error &e) {
             logger.error(e.what());
             return;
         }
+
+        if (parser.isSet(record) && !server->startRecord(parser.value(record)))
+            return;
+
+        if (parser.isSet(cache)) {
+            bool Ok;
+            int freshness = parser.value(cache).toInt(&Ok);
+            if (!Ok) {
+                logger.error("cache freshness input error");
+                return;
+            }
+            server->setCacheFreshness(freshness);
+            logger.info("GET cache freshness {}ms", freshness);
+        }
+
+        if (parser.isSet(name))
+            server->setServerName(parser.value(name));
+        logger.info("server name '{}'", server->getServerName());
+
+        for (const QString &peerString : parser.values(peer)) {
+            QStringList hostPort = peerString.split(':');
+            bool Ok = false;
+            uint16_t peerPort = hostPort.size() == 2 ? hostPort[1].toUShort(&Ok) : 0;
+            QHostAddress peerAddr(hostPort[0]);
+            if (!Ok || peerAddr.isNull()) {
+                logger.error("peer '{}' input error", peerString);
+                continue;
+            }
+            server->addPeer(peerAddr, peerPort);
+        }
     }
 
 protected:
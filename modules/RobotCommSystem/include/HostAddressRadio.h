@@ -12,23 +12,93 @@
 #include <QTimer>
 #include <QUdpSocket>
 #include <QHostAddress>
-#include <QNetworkAddressEntry>
+#include <QtEndian>
 
+/**
+ * 服务发现
+ * @brief 服务端周期性向组播组发送二进制信标，并立即应答客户端的发现请求
+ *        客户端通过信标的来源地址得到服务器IP，按负载选择服务器
+ */
 class HostAddressRadio : public QObject {
 Q_OBJECT
 
-    spdlogger logger;
-    QTimer *timer;
-    QUdpSocket *broadcast;
-    QList<QNetworkAddressEntry> HostAddressEntry;
-    QByteArray hostAddressJsonData;
-
 public:
-    HostAddressRadio(QObject *parent = nullptr);
+    static const uint32_t MAGIC = 0x42534352;        //!<@brief 信标魔数 "RCSB"
+    static const uint8_t VERSION = 1;                //!<@brief 协议版本
+    static const uint16_t DEFAULT_PORT = 8849;       //!<@brief 默认UDP端口
+    static const char *const MULTICAST_GROUP;        //!<@brief 组播组地址
+
+    typedef enum {
+        BEACON,         //!<@brief 服务端信标
+        QUERY,          //!<@brief 客户端发现请求
+    } BEACON_TYPE;
+
+#pragma pack(push, 1)
+    /**
+     * 信标数据包，小端序
+     */
+    struct Beacon {
+        quint32_le magic;       //!<@brief 魔数
+        quint8 version;         //!<@brief 协议版本
+        quint8 type;            //!<@brief 类型 {@link BEACON_TYPE}
+        quint16_le tcpPort;     //!<@brief 服务端TCP端口
+        quint32_le serverId;    //!<@brief 服务端ID，每次启动随机生成
+        quint16_le load;        //!<@brief 服务端负载（已连接客户端数）
+    };
+#pragma pack(pop)
+
+    /**
+     * 解析信标
+     * @param data 数据报
+     * @param[out] beacon 解析结果
+     * @return 数据报是否为合法信标
+     */
+    static bool decode(const QByteArray &data, Beacon &beacon);
+
+    /**
+     * 生成发现请求
+     * @return 数据报
+     */
+    static QByteArray query();
+
+    /**
+     * 构造函数
+     * @param tcpPort 服务端TCP端口
+     * @param udpPort 信标使用的UDP端口
+     * @param parent 父对象
+     */
+    HostAddressRadio(uint16_t tcpPort, uint16_t udpPort = DEFAULT_PORT, QObject *parent = nullptr);
+
+    /**
+     * 设置服务端负载，随信标发出
+     * @param load 负载
+     */
+    inline void setLoad(uint16_t load) {
+        beacon.load = load;
+    }
+
+    inline uint32_t getServerId() const {
+        return beacon.serverId;
+    }
 
     inline void stop() {
         timer->stop();
     }
+
+private:
+    spdlogger logger;
+    QTimer *timer;
+    QUdpSocket *udpSocket;
+    uint16_t udpPort;
+    Beacon beacon;
+
+    inline QByteArray beaconData() const {
+        return QByteArray((const char *) &beacon, sizeof(Beacon));
+    }
+
+private slots:
+
+    void UdpReadyRead();
 };
 
 #endif
@@ -15,15 +15,28 @@
 #include <QWaitCondition>
 #include <QTcpServer>
 #include "TcpConnect.h"
+#include "HostAddressRadio.h"
 
 class RCS_Client : public QObject {
 Q_OBJECT
     using getCallback = std::function<QJsonObject(const QString &, const QJsonObject &)>;
     using setCallback = std::function<void(const QString &, const QJsonObject &)>;
+    /**
+     * 发现的服务器
+     */
+    struct ServerCandidate {
+        QHostAddress addr;
+        uint16_t port;
+        uint16_t load;
+    };
+
     uint16_t TcpPort;
     spdlogger logger;
-    QList<QNetworkAddressEntry> HostAddressEntry;
-    QUdpSocket *udpSocket = nullptr;
+    QUdpSocket *udpSocket = nullptr;        //!<@brief 组播信标接收
+    QUdpSocket *querySocket = nullptr;      //!<@brief 发现请求发送及应答接收
+    QTimer *queryTimer = nullptr;           //!<@brief 发现请求重发定时器
+    QTimer *selectTimer = nullptr;          //!<@brief 服务器选择窗口定时器
+    QMap<uint32_t, ServerCandidate> serverCandidates;
     TcpConnect *pTcpConnect = nullptr;
 
     QMutex udpMutex;
@@ -40,10 +53,13 @@ Q_OBJECT
 
     QMap<QString, std::pair<getCallback, setCallback>> callBackMap;
 public:
+    static const int SELECT_WINDOW = 50;    //!<@brief 收到首个信标后等待其他服务器应答的时间，单位ms
 
     /**
-     * 构造函数
+     * 构造函数，通过组播服务发现连接负载最低的服务器
      * @param _ClientName 客户端名
+     * @param _TcpPort 未使用，服务器端口由信标给出
+     * @param _UdpPort 服务发现使用的UDP端口
      * @param parent 父对象
      */
     RCS_Client(const QString &_ClientName, uint16_t _TcpPort = 8550, uint16_t _UdpPort = 8849,
@@ -119,6 +135,24 @@ public:
         return Connected;
     }
 
+    /**
+     * 获取与服务器之间的往返时延
+     * @return 平滑往返时延，单位ms，未连接或还没有测量结果时返回-1
+     */
+    inline double getRtt() {
+        return Connected ? pTcpConnect->getRtt() : -1;
+    }
+
+    /**
+     * 设置心跳参数
+     * @see TcpConnect::setHeartbeat
+     * @param interval 心跳周期，单位ms，小于等于0关闭心跳
+     * @param maxMissed 允许连续丢失的心跳数
+     */
+    inline void setHeartbeat(int interval, int maxMissed = TcpConnect::DEFAULT_HEARTBEAT_MAX_MISSED) {
+        if (waitConnected()) pTcpConnect->setHeartbeat(interval, maxMissed);
+    }
+
     /**
      * 等待链接就绪
      * @param deadline 超时时间
@@ -175,11 +209,42 @@ public:
         if (waitConnected()) pTcpConnect->send_PUSH(target, var, val);
     }
 
+    /**
+     * 发布变量值到服务器缓存
+     * @details 服务器开启缓存后，其他客户端对本客户端该变量的GET请求（不带附加信息）
+     *          在缓存有效期内由服务器直接应答，不再转发到本客户端；对该变量的PUSH会清除缓存
+     * @warning 缓存应答不调用getter，getter的请求者参数对缓存应答无效
+     * @see RCS_Server::setCacheFreshness
+     * @param var 变量名
+     * @param val 变量值
+     */
+    inline void PUBLISH(const QString &var, const QJsonObject &val) {
+        if (waitConnected()) pTcpConnect->send_PUBLISH(var, val);
+    }
+
+    /**
+     * 调用已注册的getter并发布变量值到服务器缓存
+     * @param var 变量名
+     * @return 变量已注册getter
+     */
+    bool PUBLISH(const QString &var);
+
+private:
+    /**
+     * 连接服务器并绑定信号
+     * @param addr 服务器地址
+     * @param port 服务器端口
+     * @return 连接成功
+     */
+    bool connectServer(const QHostAddress &addr, uint16_t port);
+
     /* 内部槽用户无需关心 */
 protected slots:
 
     void UdpReadyRead();
 
+    void selectServer();
+
     void receive_GET(const QString &from, const QString &var, const QJsonObject &info);
 
     void receive_PUSH(const QString &from, const QString &var, const QJsonObject &val);
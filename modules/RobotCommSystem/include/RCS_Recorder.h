@@ -0,0 +1,162 @@
+/**
+ * @file RCS_Recorder.h
+ * @brief RCS流量记录与读取
+ */
+
+#ifndef KDROBOTCPPLIBS_RCS_RECORDER_H
+#define KDROBOTCPPLIBS_RCS_RECORDER_H
+
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <spdlogger.h>
+#include "TcpConnect.h"
+
+/**
+ * 一条记录
+ */
+struct RCS_Record {
+    qint64 timestamp;               //!<@brief 微秒单位的UNIX时间戳
+    TcpConnect::PACK_TYPE type;     //!<@brief 帧类型
+    QString from;                   //!<@brief 来源客户端
+    QString to;                     //!<@brief 目标客户端，广播为空
+    QByteArray payload;             //!<@brief 帧内容，紧凑Json
+};
+
+/**
+ * 记录文件格式
+ * @details 日志文件: 文件头 + 若干条(记录头 + from + to + payload)
+ *          索引文件: 日志文件名加".idx"，每条记录一个(时间戳, 偏移)
+ *          结构体按1字节对齐无填充，整数为写入主机的字节序，只能在相同字节序的主机上读取
+ *          时间戳在同一文件内不递减，系统时钟回调时沿用上一条的时间戳
+ */
+namespace RCS_RecordFormat {
+    static const char MAGIC[8] = {'R', 'C', 'S', 'L', 'O', 'G', '0', '1'};
+
+#pragma pack(push, 1)
+    struct FileHead {
+        char magic[8];          //!<@brief 魔数
+        quint64 dataEnd;        //!<@brief 已提交数据末尾偏移
+    };
+
+    struct RecordHead {
+        qint64 timestamp;       //!<@brief 微秒单位的UNIX时间戳
+        quint8 type;            //!<@brief 帧类型
+        quint16 fromLen;        //!<@brief from长度
+        quint16 toLen;          //!<@brief to长度
+        quint32 payloadLen;     //!<@brief payload长度
+    };
+
+    struct IndexEntry {
+        qint64 timestamp;       //!<@brief 微秒单位的UNIX时间戳
+        quint64 offset;         //!<@brief 记录在日志文件中的偏移
+    };
+#pragma pack(pop)
+}
+
+/**
+ * 记录器
+ * @brief 将帧追加写入内存映射的日志文件，空间不足时扩大文件重新映射，
+ *        文件头中的dataEnd在每条记录写完后更新，进程异常退出时已写入的记录仍然有效
+ */
+class RCS_Recorder {
+    spdlogger logger;
+    QMutex mutex;
+    QFile logFile;
+    QFile indexFile;
+    uchar *map = nullptr;
+    quint64 capacity = 0;
+    quint64 dataEnd = 0;
+    qint64 lastTimestamp = 0;
+
+    bool remap(quint64 newCapacity);
+
+public:
+    static const quint64 CHUNK_SIZE = 16 * 1024 * 1024;    //!<@brief 文件每次扩大的大小
+
+    RCS_Recorder() : logger(__FUNCTION__) {}
+
+    ~RCS_Recorder();
+
+    /**
+     * 打开日志文件，已存在则截断
+     * @param path 日志文件路径
+     * @return 打开成功
+     */
+    bool open(const QString &path);
+
+    /**
+     * 关闭日志文件，文件截断到实际大小
+     */
+    void close();
+
+    inline bool isOpen() const {
+        return map != nullptr;
+    }
+
+    /**
+     * 追加一条记录，可跨线程调用
+     * @param type 帧类型
+     * @param from 来源客户端
+     * @param to 目标客户端
+     * @param payload 帧内容
+     */
+    void record(TcpConnect::PACK_TYPE type, const QString &from, const QString &to, const QJsonObject &payload);
+};
+
+/**
+ * 记录读取器
+ * @brief 只读映射日志文件，有索引文件时加载索引，索引缺失或不完整时扫描日志补全
+ */
+class RCS_RecordReader {
+    spdlogger logger;
+    QFile logFile;
+    const uchar *map = nullptr;
+    quint64 dataEnd = 0;
+    QVector<RCS_RecordFormat::IndexEntry> index;
+
+    /**
+     * 检查记录是否完整位于已提交数据内
+     * @param offset 记录偏移
+     * @return 记录长度，越界时返回0
+     */
+    quint64 recordSize(quint64 offset) const;
+
+public:
+    RCS_RecordReader() : logger(__FUNCTION__) {}
+
+    ~RCS_RecordReader();
+
+    /**
+     * 打开日志文件
+     * @param path 日志文件路径
+     * @return 打开成功
+     */
+    bool open(const QString &path);
+
+    /**
+     * 记录条数
+     * @return 记录条数
+     */
+    inline int size() const {
+        return index.size();
+    }
+
+    /**
+     * 读取一条记录
+     * @param i 记录序号
+     * @return 记录
+     * @throw std::out_of_range 序号越界
+     * @throw std::runtime_error 记录超出已提交数据
+     */
+    RCS_Record at(int i) const;
+
+    /**
+     * 查找第一条时间戳不早于timestamp的记录，依赖记录时间戳不递减
+     * @param timestamp 微秒单位的UNIX时间戳
+     * @return 记录序号
+     */
+    int lowerBound(qint64 timestamp) const;
+};
+
+#endif
@@ -11,9 +11,11 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QTcpServer>
+#include <QElapsedTimer>
 #include "spdlogger.h"
 #include "HostAddressRadio.h"
 #include "TcpConnect.h"
+#include "RCS_Recorder.h"
 
 class RCS_Server : public QObject {
 Q_OBJECT
@@ -26,8 +28,48 @@ Q_OBJECT
     QMutex mutex;
     QMap<QString, TcpConnect *> clientList;
     QMap<QString, std::pair<getCallback, setCallback>> callBackMap;
+    int heartbeatInterval = TcpConnect::DEFAULT_HEARTBEAT_INTERVAL;
+    int heartbeatMaxMissed = TcpConnect::DEFAULT_HEARTBEAT_MAX_MISSED;
+
+    /**
+     * 其他服务器的客户端目录
+     */
+    struct PeerDirectory {
+        qint64 epoch;               //!<@brief 所属服务器的启动标识
+        qint64 seq;                 //!<@brief 目录序号
+        QStringList clients;        //!<@brief 客户端列表
+        TcpConnect *via;            //!<@brief 下一跳服务器链接
+        QElapsedTimer updated;      //!<@brief 最后更新时间
+    };
+
+    QString serverName;                                 //!<@brief 服务器名，联邦内唯一
+    qint64 directorySeq = 0;                            //!<@brief 本地目录序号
+    qint64 broadcastSeq = 0;                            //!<@brief 本地发出的广播序号
+    qint64 bootEpoch = 0;                               //!<@brief 启动标识，取启动时间，区分重启前后的目录和广播序号
+    QTimer *directoryTimer;                             //!<@brief 目录刷新定时器
+    QList<TcpConnect *> peerList;                       //!<@brief 服务器间链接
+    QMap<TcpConnect *, QPair<QHostAddress, uint16_t>> peerAddress;  //!<@brief 主动发起的服务器间链接地址
+    QMap<QString, PeerDirectory> peerDirectory;         //!<@brief 服务器名到目录
+    QMap<QString, QString> remoteClients;               //!<@brief 远端客户端名到所在服务器名
+    QMap<QString, QPair<qint64, qint64>> peerBroadcastSeq;  //!<@brief 各服务器的启动标识和最后收到的广播序号，目录清除时一并清除
+
+    RCS_Recorder *recorder = nullptr;                   //!<@brief 流量记录器，未开启记录时为空
+
+    /**
+     * 客户端发布的变量值
+     */
+    struct CacheEntry {
+        QJsonObject val;            //!<@brief 变量值
+        QElapsedTimer updated;      //!<@brief 发布时间
+    };
+
+    int cacheFreshness = 0;                             //!<@brief 缓存有效期，单位ms，0为关闭缓存
+    QMap<QString, QMap<QString, CacheEntry>> valueCache;    //!<@brief 客户端名到变量名到缓存值
+
 public:
     static QString  __NAME__;
+    static const int DIRECTORY_REFRESH_INTERVAL = 5000;  //!<@brief 目录刷新周期，单位ms，3个周期未刷新的目录被清除
+    static const int PEER_RETRY_INTERVAL = 2000;         //!<@brief 服务器间链接重连周期，单位ms
     /**
      * 构造函数
      * @param TcpPort 使用的Tcp端口
@@ -133,14 +175,155 @@ public:
      */
     bool disconnect(const QString &name);
 
+    /**
+     * 设置心跳参数，对已连接和之后连接的客户端都生效
+     * @see TcpConnect::setHeartbeat
+     * @param interval 心跳周期，单位ms，小于等于0关闭心跳
+     * @param maxMissed 允许连续丢失的心跳数
+     */
+    void setHeartbeat(int interval, int maxMissed = TcpConnect::DEFAULT_HEARTBEAT_MAX_MISSED);
+
+    /**
+     * 获取客户端往返时延
+     * @param name 客户端名
+     * @return 平滑往返时延，单位ms，客户端不存在或还没有测量结果时返回-1
+     */
+    double getClientRtt(const QString &name);
+
+    /**
+     * 获取所有客户端往返时延
+     * @return 客户端名到往返时延(ms)的映射
+     */
+    QMap<QString, double> getClientRttMap();
+
+    /**
+     * 设置服务器名，联邦内每个服务器的名字必须唯一
+     * @note 默认使用随机名字，应在添加服务器间链接之前设置
+     * @param name 服务器名
+     */
+    inline void setServerName(const QString &name) {
+        serverName = name;
+    }
+
+    /**
+     * 获取服务器名
+     * @return 服务器名
+     */
+    inline const QString &getServerName() const {
+        return serverName;
+    }
+
+    /**
+     * 连接到另一个服务器组成联邦，之后连接到任一服务器的客户端可以相互PUSH、GET、BROADCAST
+     * @note 异步连接，连接失败或链接断开后自动重连
+     * @param addr 服务器地址
+     * @param port 服务器TCP端口
+     */
+    void addPeer(const QHostAddress &addr, uint16_t port);
+
+    /**
+     * 获取通过其他服务器可达的客户端名字列表
+     * @return 远端客户端名字列表
+     */
+    QList<QString> getRemoteClientNameList();
+
+    /**
+     * 开始记录路由的每一帧
+     * @see RCS_Recorder RCS_RecordReader
+     * @param path 日志文件路径，索引文件为path + ".idx"
+     * @return 打开日志文件成功
+     */
+    bool startRecord(const QString &path);
+
+    /**
+     * 停止记录
+     */
+    void stopRecord();
+
+    /**
+     * 设置GET缓存有效期
+     * @details 客户端通过RCS_Client::PUBLISH发布的变量值会被缓存，
+     *          有效期内对该变量不带附加信息的GET请求由服务器直接以目标客户端名义应答；
+     *          转发给该客户端的同名变量PUSH会清除缓存，客户端重新发布前的GET仍由客户端应答
+     * @warning 缓存应答不调用客户端的getter，getter不能区分请求者，对不同请求者返回不同值的变量不应发布
+     * @param freshness 有效期，单位ms，0关闭缓存
+     */
+    inline void setCacheFreshness(int freshness) {
+        cacheFreshness = freshness;
+    }
+
+    ~RCS_Server();
+
 private:
+    inline void record(TcpConnect::PACK_TYPE type, const QString &from, const QString &to,
+                       const QJsonObject &payload) {
+        if (recorder != nullptr) recorder->record(type, from, to, payload);
+    }
+
+    void setupPeer(TcpConnect *pTcpConnect);
+
+    void advertiseDirectory();
+
+    void sendDirectories(TcpConnect *pTcpConnect);
+
+    void rebuildRemoteClients();
+
+    /**
+     * 构建服务器间转发帧
+     * @param kind 原始请求类型
+     * @param from 来源客户端
+     * @param sendTo 目标客户端，广播为空
+     * @return 转发帧
+     */
+    QJsonObject makeForward(TcpConnect::PACK_TYPE kind, const QString &from, const QString &sendTo);
+
+    /**
+     * 按目录转发单播帧
+     * @param frame 转发帧
+     * @return 找到目标客户端所在服务器
+     */
+    bool forwardUnicast(const QJsonObject &frame);
+
+    /**
+     * 尝试用缓存应答GET请求，应答以PUSH形式发回请求者，请求者可以是远端客户端
+     * @param from 请求者
+     * @param sendTo 目标客户端
+     * @param var 变量名
+     * @param info 附加信息，不为空时不使用缓存
+     * @return 已用缓存应答
+     */
+    bool answerFromCache(const QString &from, const QString &sendTo, const QString &var, const QJsonObject &info);
+
+    /**
+     * 清除客户端变量的缓存值，PUSH写入后缓存不再代表客户端的当前值
+     * @param client 客户端名
+     * @param var 变量名
+     */
+    void invalidateCache(const QString &client, const QString &var);
+
+    /**
+     * 向除except外的所有服务器转发广播帧
+     * @param frame 转发帧
+     * @param except 不转发的链接
+     */
+    void forwardBroadcast(const QJsonObject &frame, TcpConnect *except = nullptr);
+
     QJsonObject GET_ClientList(const QString &, const QJsonObject &);
 
+    QJsonObject GET_ClientRtt(const QString &, const QJsonObject &);
+
 signals:
     void NewClient(const QHostAddress &addr, const QString &name);
 
     void ClientDisconnected(const QString &name);
 
+    /**
+     * 客户端往返时延更新信号量
+     * @param name 客户端名
+     * @param rtt 平滑往返时延，单位ms
+     */
+    void ClientRttUpdated(const QString &name, double rtt);
+
     /**
      * 返回值信号量
      * @param type
@@ -173,7 +356,18 @@ protected slots:
 
     void TcpConnect_receive_CLIENT_RET(const QString &from, const QString &sendTo, const QJsonObject &ret);
 
+    void TcpConnect_receive_PUBLISH(const QString &from, const QString &var, const QJsonObject &val);
+
     void TcpConnect_disconnected(const QString &name);
+
+    void TcpConnect_receive_PEER_DIRECTORY(TcpConnect *pTcpConnect, const QString &server, qint64 epoch, qint64 seq,
+                                           const QStringList &clients);
+
+    void TcpConnect_receive_PEER_FORWARD(TcpConnect *pTcpConnect, const QJsonObject &frame);
+
+    void Peer_disconnected(TcpConnect *pTcpConnect);
+
+    void directoryRefresh();
 };
 
 
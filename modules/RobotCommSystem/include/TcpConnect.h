@@ -17,6 +17,8 @@
 #include <QTimer>
 #include <QJsonDocument>
 #include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <atomic>
 
 /**
  * TCP连接层
@@ -41,6 +43,11 @@ public:
         SERVER_RET,     //!<@brief 服务端返回值标识
         CLIENT_RET,     //!<@brief 客户端返回值标识
         DIRECT_LINK,    //!<@brief 直连请求标识 TODO DIRECT_LINK未完成
+        HEARTBEAT,      //!<@brief 心跳标识
+        HEARTBEAT_RET,  //!<@brief 心跳应答标识
+        PEER_DIRECTORY, //!<@brief 服务器间客户端目录标识
+        PEER_FORWARD,   //!<@brief 服务器间转发标识
+        PUBLISH,        //!<@brief 发布变量值到服务器缓存标识
     } PACK_TYPE;
 
     static const char *PACK_TYPE_ToString(PACK_TYPE type);
@@ -58,9 +65,59 @@ private:
     QString name;
     spdlogger logger;
     MODE_TYPE mode;
+    bool peer;                              //!<@brief 服务器间链接标志
+
+    QTimer *heartbeatTimer;                 //!<@brief 心跳定时器
+    QElapsedTimer elapsedTimer;             //!<@brief 心跳时间基准
+    int heartbeatMaxMissed = 3;             //!<@brief 允许连续丢失的心跳数
+    int heartbeatMissed = 0;                //!<@brief 自上次收到数据起经过的心跳周期数
+    std::atomic<double> rtt{-1};            //!<@brief 平滑往返时延，单位ms，没有样本时为-1
+
+public:
+    static const int DEFAULT_HEARTBEAT_INTERVAL = 1000;  //!<@brief 默认心跳周期，单位ms
+    static const int DEFAULT_HEARTBEAT_MAX_MISSED = 3;   //!<@brief 默认允许连续丢失的心跳数
+
+    /**
+     * 设置心跳参数，可跨线程调用
+     * @details 每个周期发送一次心跳，对端应答后更新往返时延；
+     *          连续maxMissed个周期没有收到任何数据则认为链接已断开，主动断开链接
+     * @param interval 心跳周期，单位ms，小于等于0关闭心跳
+     * @param maxMissed 允许连续丢失的心跳数
+     */
+    void setHeartbeat(int interval, int maxMissed = DEFAULT_HEARTBEAT_MAX_MISSED);
+
+    /**
+     * 获取平滑往返时延
+     * @return 往返时延，单位ms，还没有测量结果时返回-1
+     */
+    inline double getRtt() const {
+        return rtt.load();
+    }
+
+    /**
+     * 获取连接名
+     * @return 连接名
+     */
+    inline const QString &getName() const {
+        return name;
+    }
+
+    /**
+     * 判断是否为服务器间链接
+     * @return 服务器间链接
+     */
+    inline bool isPeer() const {
+        return peer;
+    }
 
 protected:
-    TcpConnect(QTcpSocket *Socket, const QString &_name = QString());
+    /**
+     * 构造函数
+     * @param Socket 已连接的Socket
+     * @param _name 连接名，为空时作为服务端链接等待HEAD
+     * @param _peer 作为服务器间链接发起，HEAD中带有peer标志
+     */
+    TcpConnect(QTcpSocket *Socket, const QString &_name = QString(), bool _peer = false);
 
     /**
      * 发送说明头
@@ -111,6 +168,39 @@ protected:
      */
     void send_CLIENT_RET(const QString &from_sendTo, const QJsonObject &ret);
 
+    /**
+     * 发送心跳，客户端服务器共用
+     */
+    void send_HEARTBEAT();
+
+    /**
+     * 发送心跳应答，客户端服务器共用
+     * @param t 对端心跳中的时间戳
+     */
+    void send_HEARTBEAT_RET(double t);
+
+    /**
+     * 发送客户端目录，服务器间链接使用
+     * @param server 目录所属服务器名
+     * @param epoch 目录所属服务器的启动标识，重启后序号从头开始，与序号一起用于去重
+     * @param seq 目录序号，用于去重
+     * @param clients 该服务器的本地客户端列表
+     */
+    void send_PEER_DIRECTORY(const QString &server, qint64 epoch, qint64 seq, const QStringList &clients);
+
+    /**
+     * 发送转发帧，服务器间链接使用
+     * @param frame 转发帧，由RCS_Server构建
+     */
+    void send_PEER_FORWARD(QJsonObject frame);
+
+    /**
+     * 发布变量值到服务器缓存，仅由客户端调用
+     * @param var 变量名
+     * @param val 变量值
+     */
+    void send_PUBLISH(const QString &var, const QJsonObject &val);
+
     virtual ~TcpConnect();
 
 private:
@@ -128,6 +218,8 @@ protected slots:
 
     void WaitHEADTimeout();
 
+    void HeartbeatTimeout();
+
     void write(QByteArray data);
 
 
@@ -145,6 +237,13 @@ Q_SIGNALS:
      */
     void disconnected(const QString &name);
 
+    /**
+     * 往返时延更新信号量
+     * @param name 连接名
+     * @param rtt 平滑往返时延，单位ms
+     */
+    void rttUpdated(const QString &name, double rtt);
+
     /**
      * 接收到广播消息，服务端客户端相同
      * @param from 来源（服务端为链接自己的名字，客户端为发送者的名字）
@@ -177,6 +276,14 @@ Q_SIGNALS:
      */
     void ServerReceive_GET(const QString &from, const QString &target, const QString &var, const QJsonObject &info);
 
+    /**
+     * 服务端收到发布的变量值
+     * @param from 来源（本链接客户端名字）
+     * @param var 变量名
+     * @param val 变量值
+     */
+    void ServerReceive_PUBLISH(const QString &from, const QString &var, const QJsonObject &val);
+
     /**
      * 服务器收到客户端返回值
      * @param from 来源（发送者名）
@@ -185,6 +292,24 @@ Q_SIGNALS:
      */
     void ServerReceive_CLIENT_RET(const QString &from, const QString &sendTo, const QJsonObject &val);
 
+    /**
+     * 收到服务器客户端目录
+     * @param connect 链接指针
+     * @param server 目录所属服务器名
+     * @param epoch 目录所属服务器的启动标识
+     * @param seq 目录序号
+     * @param clients 客户端列表
+     */
+    void PeerReceive_DIRECTORY(TcpConnect *connect, const QString &server, qint64 epoch, qint64 seq,
+                               const QStringList &clients);
+
+    /**
+     * 收到服务器间转发帧
+     * @param connect 链接指针
+     * @param frame 转发帧
+     */
+    void PeerReceive_FORWARD(TcpConnect *connect, const QJsonObject &frame);
+
     /**
      * 客户端接收到PUSH
      * @param from 来源（发送者名）
@@ -5,41 +5,59 @@
  */
 
 #include "HostAddressRadio.h"
-#include <QNetworkInterface>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-
-HostAddressRadio::HostAddressRadio(QObject *parent) :
-        QObject(parent), logger(__FUNCTION__),
-        timer(new QTimer(this)), broadcast(new QUdpSocket(this)) {
-    QNetworkInterface networkInterface;
-    logger.info("HostAddress:");
-    for (const QNetworkInterface &anInterface : networkInterface.allInterfaces()) {
-        logger.info("\tNetwork Interface Name:{}", anInterface.humanReadableName());
-        for (const QNetworkAddressEntry &addressEntry : anInterface.addressEntries()) {
-            logger.info("\t\tIP:{} MASK:{}", addressEntry.ip(), addressEntry.netmask());
-            if (!addressEntry.ip().isLoopback() && addressEntry.ip().toIPv4Address() != 0) {
-                HostAddressEntry.append(addressEntry);
-            }
-        }
-    }
-    QJsonDocument jsonDocument;
-    QJsonObject jsonObject;
-    QJsonArray jsonArray;
-    for (const QNetworkAddressEntry &addressEntry : HostAddressEntry) {
-        QJsonObject EntryObject;
-        EntryObject.insert("IP", addressEntry.ip().toString());
-        EntryObject.insert("MASK", addressEntry.netmask().toString());
-        jsonArray.append(EntryObject);
-    }
-    jsonObject.insert("hostAddress", jsonArray);
-    jsonDocument.setObject(jsonObject);
-    hostAddressJsonData = jsonDocument.toJson(QJsonDocument::Compact);
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+
+const char *const HostAddressRadio::MULTICAST_GROUP = "239.255.88.49";
+
+bool HostAddressRadio::decode(const QByteArray &data, HostAddressRadio::Beacon &beacon) {
+    if (data.size() != sizeof(Beacon))
+        return false;
+    memcpy(&beacon, data.constData(), sizeof(Beacon));
+    return beacon.magic == MAGIC && beacon.version == VERSION;
+}
+
+QByteArray HostAddressRadio::query() {
+    Beacon q = {};
+    q.magic = MAGIC;
+    q.version = VERSION;
+    q.type = QUERY;
+    return QByteArray((const char *) &q, sizeof(Beacon));
+}
+
+HostAddressRadio::HostAddressRadio(uint16_t tcpPort, uint16_t udpPort, QObject *parent) :
+        QObject(parent), logger(__FUNCTION__), timer(new QTimer(this)),
+        udpSocket(new QUdpSocket(this)), udpPort(udpPort) {
+    beacon.magic = MAGIC;
+    beacon.version = VERSION;
+    beacon.type = BEACON;
+    beacon.tcpPort = tcpPort;
+    beacon.serverId = QRandomGenerator::global()->generate();
+    beacon.load = 0;
+    logger.info("server id 0x{:08X}, group {}:{}", (uint32_t) beacon.serverId, MULTICAST_GROUP, udpPort);
+
+    if (!udpSocket->bind(QHostAddress::AnyIPv4, udpPort,
+                         QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+        logger.error("can't bind udp port {}", udpPort);
+    if (!udpSocket->joinMulticastGroup(QHostAddress(MULTICAST_GROUP)))
+        logger.warn("can't join multicast group {}", MULTICAST_GROUP);
+    udpSocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+    connect(udpSocket, SIGNAL(readyRead()), this, SLOT(UdpReadyRead()));
 
     timer->callOnTimeout([=]() {
-        broadcast->writeDatagram(hostAddressJsonData, QHostAddress::Broadcast, 8849);
+        udpSocket->writeDatagram(beaconData(), QHostAddress(MULTICAST_GROUP), this->udpPort);
     });
-
     timer->start(500);
 }
+
+void HostAddressRadio::UdpReadyRead() {
+    while (udpSocket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = udpSocket->receiveDatagram();
+        Beacon q;
+        if (!decode(datagram.data(), q) || q.type != QUERY)
+            continue;
+        /* 发现请求直接单播应答，不等待下一个信标周期 */
+        logger.debug("discovery query from {}:{}", datagram.senderAddress(), datagram.senderPort());
+        udpSocket->writeDatagram(beaconData(), datagram.senderAddress(), datagram.senderPort());
+    }
+}
@@ -4,7 +4,6 @@
  * @date 2021年1月13日
  */
 
-#include <QNetworkInterface>
 #include <QNetworkDatagram>
 #include "RCS_Client.h"
 
@@ -15,22 +14,35 @@ RCS_Client::RCS_Client(const QString &_ClientName, uint16_t _TcpPort, uint16_t _
         logger.error("ClientName is empty");
         throw std::runtime_error("ClientName is empty");
     }
-    udpSocket = new QUdpSocket(this);
-    QNetworkInterface networkInterface;
-    logger.info("HostAddress:");
-    for (const QNetworkInterface &anInterface : networkInterface.allInterfaces()) {
-        logger.info("\tNetwork Interface Name:{}", anInterface.humanReadableName());
-        for (const QNetworkAddressEntry &addressEntry : anInterface.addressEntries()) {
-            logger.info("\t\tIP:{} MASK:{}", addressEntry.ip(), addressEntry.netmask());
-            if (!addressEntry.ip().isLoopback() && addressEntry.ip().toIPv4Address() != 0) {
-                HostAddressEntry.append(addressEntry);
-            }
-        }
-    }
-    udpSocket->bind(_UdpPort, QUdpSocket::ShareAddress);
-    connect(udpSocket, SIGNAL(readyRead()), this, SLOT(UdpReadyRead()));
     waitMutex.lock();
     blockMutex.lock();
+
+    udpSocket = new QUdpSocket(this);
+    if (!udpSocket->bind(QHostAddress::AnyIPv4, _UdpPort,
+                         QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+        logger.error("can't bind udp port {}", _UdpPort);
+    if (!udpSocket->joinMulticastGroup(QHostAddress(HostAddressRadio::MULTICAST_GROUP)))
+        logger.warn("can't join multicast group {}", HostAddressRadio::MULTICAST_GROUP);
+    connect(udpSocket, SIGNAL(readyRead()), this, SLOT(UdpReadyRead()));
+
+    /* 发现请求使用临时端口，服务端单播应答不会和同机其他进程争抢端口 */
+    querySocket = new QUdpSocket(this);
+    querySocket->bind(QHostAddress::AnyIPv4, 0);
+    querySocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+    connect(querySocket, SIGNAL(readyRead()), this, SLOT(UdpReadyRead()));
+
+    selectTimer = new QTimer(this);
+    selectTimer->setSingleShot(true);
+    connect(selectTimer, SIGNAL(timeout()), this, SLOT(selectServer()));
+
+    queryTimer = new QTimer(this);
+    queryTimer->callOnTimeout([=]() {
+        querySocket->writeDatagram(HostAddressRadio::query(),
+                                   QHostAddress(HostAddressRadio::MULTICAST_GROUP), _UdpPort);
+    });
+    queryTimer->start(1000);
+    querySocket->writeDatagram(HostAddressRadio::query(),
+                               QHostAddress(HostAddressRadio::MULTICAST_GROUP), _UdpPort);
 }
 
 RCS_Client::RCS_Client(const QString &_ClientName, const QHostAddress &addr, uint16_t _TcpPort, QObject *parent)
@@ -38,105 +50,90 @@ RCS_Client::RCS_Client(const QString &_ClientName, const QHostAddress &addr, uin
     logger.info("Custom IP:{} Port:{}", addr, _TcpPort);
     TcpPort = _TcpPort;
     ClientName = _ClientName;
-    QTcpSocket *tcpSocket = new QTcpSocket;
-    tcpSocket->connectToHost(addr, TcpPort);
     waitMutex.lock();
-    if (tcpSocket->waitForConnected(5000)) {
-        pTcpConnect = new TcpConnect(tcpSocket, ClientName);
-
-        connect(pTcpConnect,
-                SIGNAL(ClientReceive_GET(const QString &, const QString &, const QJsonObject &)),
-                this, SLOT(receive_GET(const QString &, const QString &, const QJsonObject &)));
-
-        connect(pTcpConnect,
-                SIGNAL(ClientReceive_PUSH(const QString &, const QString &, const QJsonObject &)),
-                this, SLOT(receive_PUSH(const QString &, const QString &, const QJsonObject &)));
-
-        connect(pTcpConnect,
-                SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
-                this, SLOT(receive_BROADCAST(const QString &, const QString &, const QJsonObject &)));
-
-        connect(pTcpConnect,
-                SIGNAL(ClientReceive_CLIENT_RET(const QString &, const QJsonObject &)),
-                this, SLOT(receive_CLIENT_RET(const QString &, const QJsonObject &)));
-
-        connect(pTcpConnect,
-                SIGNAL(ClientReceive_SERVER_RET(const QJsonObject &)),
-                this, SLOT(receive_SERVER_RET(const QJsonObject &)));
-
-        connect(pTcpConnect, SIGNAL(disconnected(const QString &)), this, SIGNAL(disconnected(const QString &)));
-        Connected = true;
-        waitCondition.wakeAll();
-        waitMutex.unlock();
-    } else logger.error("Tcp Connect Time Out");
+    connectServer(addr, TcpPort);
     blockMutex.lock();
 }
 
+bool RCS_Client::connectServer(const QHostAddress &addr, uint16_t port) {
+    QTcpSocket *tcpSocket = new QTcpSocket;
+    tcpSocket->connectToHost(addr, port);
+    if (!tcpSocket->waitForConnected(5000)) {
+        logger.error("Tcp Connect Time Out");
+        tcpSocket->deleteLater();
+        return false;
+    }
+    pTcpConnect = new TcpConnect(tcpSocket, ClientName);
+
+    connect(pTcpConnect,
+            SIGNAL(ClientReceive_GET(const QString &, const QString &, const QJsonObject &)),
+            this, SLOT(receive_GET(const QString &, const QString &, const QJsonObject &)));
+
+    connect(pTcpConnect,
+            SIGNAL(ClientReceive_PUSH(const QString &, const QString &, const QJsonObject &)),
+            this, SLOT(receive_PUSH(const QString &, const QString &, const QJsonObject &)));
+
+    connect(pTcpConnect,
+            SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
+            this, SLOT(receive_BROADCAST(const QString &, const QString &, const QJsonObject &)));
+
+    connect(pTcpConnect,
+            SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
+            this, SIGNAL(signal_BROADCAST(const QString &, const QString &, const QJsonObject &)));
+
+    connect(pTcpConnect,
+            SIGNAL(ClientReceive_CLIENT_RET(const QString &, const QJsonObject &)),
+            this, SLOT(receive_CLIENT_RET(const QString &, const QJsonObject &)));
+
+    connect(pTcpConnect,
+            SIGNAL(ClientReceive_SERVER_RET(const QJsonObject &)),
+            this, SLOT(receive_SERVER_RET(const QJsonObject &)));
+
+    connect(pTcpConnect, SIGNAL(disconnected(const QString &)), this, SIGNAL(disconnected(const QString &)));
+    Connected = true;
+    waitCondition.wakeAll();
+    waitMutex.unlock();
+    return true;
+}
+
 void RCS_Client::UdpReadyRead() {
     QMutexLocker locker(&udpMutex);
-    QNetworkDatagram datagram = udpSocket->receiveDatagram();
-    if (Connected)
-        return;
-    QJsonParseError err;
-    QJsonDocument jdom = QJsonDocument::fromJson(datagram.data(), &err);
-    if (err.error == QJsonParseError::NoError) {
-        QJsonArray remoteAddrEntryList = jdom.object().find("hostAddress")->toArray();
-        for (const auto &remoteAddrEntry : remoteAddrEntryList) {
-            QJsonObject EntryObject = remoteAddrEntry.toObject();
-            QHostAddress remoteIP(EntryObject.find("IP")->toString());
-            QHostAddress remoteMASK(EntryObject.find("MASK")->toString());
-            for (const auto &localAddr : HostAddressEntry) {
-                uint32_t mask = localAddr.netmask().toIPv4Address();
-                uint32_t ip = localAddr.ip().toIPv4Address();
-                uint32_t host = ip & mask;
-                if (remoteMASK.toIPv4Address() == mask && (remoteIP.toIPv4Address() & mask) == host) {
-                    logger.info("ip {}", remoteIP.toString());
-                    QTcpSocket *tcpSocket = new QTcpSocket;
-                    tcpSocket->connectToHost(remoteIP, TcpPort);
-                    if (tcpSocket->waitForConnected(5000)) {
-                        pTcpConnect = new TcpConnect(tcpSocket, ClientName);
-
-                        connect(pTcpConnect,
-                                SIGNAL(ClientReceive_GET(const QString &, const QString &, const QJsonObject &)),
-                                this, SLOT(receive_GET(const QString &, const QString &, const QJsonObject &)));
-
-                        connect(pTcpConnect,
-                                SIGNAL(ClientReceive_PUSH(const QString &, const QString &, const QJsonObject &)),
-                                this, SLOT(receive_PUSH(const QString &, const QString &, const QJsonObject &)));
-
-                        connect(pTcpConnect,
-                                SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
-                                this, SLOT(receive_BROADCAST(const QString &, const QString &, const QJsonObject &)));
-
-                        connect(pTcpConnect,
-                                SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
-                                this, SIGNAL(signal_BROADCAST(const QString &, const QString &, const QJsonObject &)));
-
-                        connect(pTcpConnect,
-                                SIGNAL(ClientReceive_CLIENT_RET(const QString &, const QJsonObject &)),
-                                this, SLOT(receive_CLIENT_RET(const QString &, const QJsonObject &)));
-
-                        connect(pTcpConnect,
-                                SIGNAL(ClientReceive_SERVER_RET(const QJsonObject &)),
-                                this, SLOT(receive_SERVER_RET(const QJsonObject &)));
-
-                        connect(pTcpConnect, SIGNAL(disconnected(const QString &)), this,
-                                SIGNAL(disconnected(const QString &)));
-                        udpSocket->deleteLater();
-                        udpSocket = nullptr;
-                        Connected = true;
-                        waitCondition.wakeAll();
-                        waitMutex.unlock();
-                        return;
-                    } else {
-                        logger.error("Tcp Connect Time Out");
-                        throw std::runtime_error("Tcp Connect Time Out");
-                    }
-                }
-            }
+    auto socket = qobject_cast<QUdpSocket *>(sender());
+    while (socket != nullptr && socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = socket->receiveDatagram();
+        HostAddressRadio::Beacon beacon;
+        if (Connected || !HostAddressRadio::decode(datagram.data(), beacon) ||
+            beacon.type != HostAddressRadio::BEACON)
+            continue;
+        QHostAddress addr(datagram.senderAddress().toIPv4Address());
+        if (!serverCandidates.contains(beacon.serverId))
+            logger.info("find server 0x{:08X} {}:{} load {}", (uint32_t) beacon.serverId, addr,
+                        (uint16_t) beacon.tcpPort, (uint16_t) beacon.load);
+        serverCandidates.insert(beacon.serverId, {addr, beacon.tcpPort, beacon.load});
+        /* 收到首个信标后开一个短窗口收集其他服务器，再选择负载最低的 */
+        if (!selectTimer->isActive())
+            selectTimer->start(SELECT_WINDOW);
+    }
+}
+
+void RCS_Client::selectServer() {
+    QMutexLocker locker(&udpMutex);
+    while (!Connected && !serverCandidates.isEmpty()) {
+        auto best = serverCandidates.begin();
+        for (auto it = serverCandidates.begin(); it != serverCandidates.end(); ++it) {
+            if (it->load < best->load)
+                best = it;
+        }
+        ServerCandidate candidate = best.value();
+        serverCandidates.erase(best);
+        logger.info("ip {} port {}", candidate.addr.toString(), candidate.port);
+        if (connectServer(candidate.addr, candidate.port)) {
+            queryTimer->stop();
+            udpSocket->deleteLater();
+            udpSocket = nullptr;
+            querySocket->deleteLater();
+            querySocket = nullptr;
         }
-    } else {
-        logger.error("Json error: {}", err.errorString());
     }
 }
 
@@ -197,6 +194,14 @@ void RCS_Client::receive_CLIENT_RET(const QString &from, const QJsonObject &ret)
     emit signal_RETURN(TcpConnect::CLIENT_RET, ret);
 }
 
+bool RCS_Client::PUBLISH(const QString &var) {
+    auto it = callBackMap.find(var);
+    if (it == callBackMap.end() || !(*it).first)
+        return false;
+    PUBLISH(var, ((*it).first)(ClientName, {}));
+    return true;
+}
+
 int RCS_Client::UnregisterCallBack(const QString &name) {
     return callBackMap.remove(name);
 }
@@ -0,0 +1,197 @@
+/**
+ * @file RCS_Recorder.cpp
+ */
+
+#include "RCS_Recorder.h"
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <QJsonDocument>
+
+using namespace RCS_RecordFormat;
+
+bool RCS_Recorder::remap(quint64 newCapacity) {
+    if (map != nullptr) {
+        logFile.unmap(map);
+        map = nullptr;
+    }
+    if (!logFile.resize(newCapacity)) {
+        logger.error("can't resize '{}' to {}", logFile.fileName(), newCapacity);
+        return false;
+    }
+    map = logFile.map(0, newCapacity);
+    if (map == nullptr) {
+        logger.error("can't map '{}'", logFile.fileName());
+        return false;
+    }
+    capacity = newCapacity;
+    return true;
+}
+
+bool RCS_Recorder::open(const QString &path) {
+    QMutexLocker lk(&mutex);
+    logFile.setFileName(path);
+    indexFile.setFileName(path + ".idx");
+    if (!logFile.open(QIODevice::ReadWrite | QIODevice::Truncate) ||
+        !indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        logger.error("can't open record file '{}'", path);
+        logFile.close();
+        indexFile.close();
+        return false;
+    }
+    if (!remap(CHUNK_SIZE)) {
+        logFile.close();
+        indexFile.close();
+        return false;
+    }
+    dataEnd = sizeof(FileHead);
+    lastTimestamp = 0;
+    auto head = (FileHead *) map;
+    memcpy(head->magic, MAGIC, sizeof(MAGIC));
+    head->dataEnd = dataEnd;
+    logger.info("record to '{}'", path);
+    return true;
+}
+
+void RCS_Recorder::close() {
+    QMutexLocker lk(&mutex);
+    if (map == nullptr)
+        return;
+    logFile.unmap(map);
+    map = nullptr;
+    logFile.resize(dataEnd);
+    logFile.close();
+    indexFile.close();
+    logger.info("record closed, {} bytes", dataEnd);
+}
+
+RCS_Recorder::~RCS_Recorder() {
+    close();
+}
+
+void RCS_Recorder::record(TcpConnect::PACK_TYPE type, const QString &from, const QString &to,
+                          const QJsonObject &payload) {
+    QByteArray fromData = from.toUtf8(), toData = to.toUtf8();
+    QByteArray payloadData = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+    RecordHead recordHead;
+    recordHead.type = type;
+    recordHead.fromLen = fromData.size();
+    recordHead.toLen = toData.size();
+    recordHead.payloadLen = payloadData.size();
+    quint64 recordSize = sizeof(RecordHead) + fromData.size() + toData.size() + payloadData.size();
+
+    QMutexLocker lk(&mutex);
+    if (map == nullptr)
+        return;
+    /* 系统时钟可能被NTP向回调整，时间戳不回退以保持索引有序 */
+    lastTimestamp = std::max(lastTimestamp, (qint64) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    recordHead.timestamp = lastTimestamp;
+    if (dataEnd + recordSize > capacity &&
+        !remap(capacity + std::max(recordSize, (quint64) CHUNK_SIZE))) {
+        logger.error("record stopped");
+        logFile.close();
+        indexFile.close();
+        return;
+    }
+    uchar *p = map + dataEnd;
+    memcpy(p, &recordHead, sizeof(RecordHead));
+    p += sizeof(RecordHead);
+    memcpy(p, fromData.constData(), fromData.size());
+    p += fromData.size();
+    memcpy(p, toData.constData(), toData.size());
+    p += toData.size();
+    memcpy(p, payloadData.constData(), payloadData.size());
+
+    IndexEntry entry = {recordHead.timestamp, dataEnd};
+    indexFile.write((const char *) &entry, sizeof(IndexEntry));
+    /* 数据写完再提交末尾偏移 */
+    dataEnd += recordSize;
+    ((FileHead *) map)->dataEnd = dataEnd;
+}
+
+bool RCS_RecordReader::open(const QString &path) {
+    logFile.setFileName(path);
+    if (!logFile.open(QIODevice::ReadOnly) || logFile.size() < (qint64) sizeof(FileHead)) {
+        logger.error("can't open record file '{}'", path);
+        return false;
+    }
+    map = logFile.map(0, logFile.size());
+    if (map == nullptr) {
+        logger.error("can't map '{}'", path);
+        return false;
+    }
+    auto head = (const FileHead *) map;
+    if (memcmp(head->magic, MAGIC, sizeof(MAGIC)) != 0 || head->dataEnd > (quint64) logFile.size()) {
+        logger.error("'{}' is not a record file", path);
+        return false;
+    }
+    dataEnd = head->dataEnd;
+
+    index.clear();
+    QFile indexFile(path + ".idx");
+    if (indexFile.open(QIODevice::ReadOnly)) {
+        QByteArray indexData = indexFile.readAll();
+        int count = indexData.size() / sizeof(IndexEntry);
+        index.resize(count);
+        memcpy(index.data(), indexData.constData(), count * sizeof(IndexEntry));
+        /* 索引可能比日志多写了未提交的记录 */
+        while (!index.isEmpty() && recordSize(index.last().offset) == 0)
+            index.removeLast();
+    }
+    /* 索引缺失或不完整时从最后一条索引之后继续扫描到dataEnd */
+    quint64 offset = sizeof(FileHead);
+    if (!index.isEmpty())
+        offset = index.last().offset + recordSize(index.last().offset);
+    if (offset < dataEnd)
+        logger.warn("index of '{}' incomplete, rebuild from offset {}", path, offset);
+    while (offset < dataEnd) {
+        quint64 size = recordSize(offset);
+        if (size == 0) {
+            logger.error("'{}' invalid record at offset {}, ignore the rest", path, offset);
+            break;
+        }
+        index.append({((const RecordHead *) (map + offset))->timestamp, offset});
+        offset += size;
+    }
+    logger.info("'{}' {} records", path, index.size());
+    return true;
+}
+
+RCS_RecordReader::~RCS_RecordReader() {
+    if (map != nullptr)
+        logFile.unmap((uchar *) map);
+}
+
+quint64 RCS_RecordReader::recordSize(quint64 offset) const {
+    if (offset < sizeof(FileHead) || offset + sizeof(RecordHead) > dataEnd)
+        return 0;
+    auto recordHead = (const RecordHead *) (map + offset);
+    quint64 size = sizeof(RecordHead) + recordHead->fromLen + recordHead->toLen + (quint64) recordHead->payloadLen;
+    return offset + size <= dataEnd ? size : 0;
+}
+
+RCS_Record RCS_RecordReader::at(int i) const {
+    if (i < 0 || i >= index.size())
+        throw std::out_of_range("record index out of range");
+    if (recordSize(index[i].offset) == 0)
+        throw std::runtime_error("record out of data range");
+    const uchar *p = map + index[i].offset;
+    auto recordHead = (const RecordHead *) p;
+    p += sizeof(RecordHead);
+    RCS_Record record;
+    record.timestamp = recordHead->timestamp;
+    record.type = (TcpConnect::PACK_TYPE) recordHead->type;
+    record.from = QString::fromUtf8((const char *) p, recordHead->fromLen);
+    p += recordHead->fromLen;
+    record.to = QString::fromUtf8((const char *) p, recordHead->toLen);
+    p += recordHead->toLen;
+    record.payload = QByteArray((const char *) p, recordHead->payloadLen);
+    return record;
+}
+
+int RCS_RecordReader::lowerBound(qint64 timestamp) const {
+    auto it = std::lower_bound(index.begin(), index.end(), timestamp,
+                               [](const IndexEntry &entry, qint64 t) { return entry.timestamp < t; });
+    return it - index.begin();
+}
@@ -6,13 +6,26 @@
 
 #include "RCS_Server.h"
 #include <QTcpSocket>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QDateTime>
 
 QString  RCS_Server::__NAME__ = "__server__";
 
+/**
+ * 比较来自同一服务器的(启动标识, 序号)，重启后的启动标识更大，序号从头开始
+ * @return (epoch, seq)比(lastEpoch, lastSeq)新
+ */
+static inline bool isNewer(qint64 epoch, qint64 seq, qint64 lastEpoch, qint64 lastSeq) {
+    return epoch > lastEpoch || (epoch == lastEpoch && seq > lastSeq);
+}
+
 void RCS_Server::tcpServer_newConnection() {
     while (pTcpServer->hasPendingConnections()) {
         QTcpSocket *socket = pTcpServer->nextPendingConnection();
-        connect(new TcpConnect(socket), SIGNAL(ServerReceive_HEAD(TcpConnect * , const QString &)),
+        auto pTcpConnect = new TcpConnect(socket);
+        pTcpConnect->setHeartbeat(heartbeatInterval, heartbeatMaxMissed);
+        connect(pTcpConnect, SIGNAL(ServerReceive_HEAD(TcpConnect * , const QString &)),
                 this, SLOT(TcpConnect_receive_HEAD(TcpConnect * , const QString &)));
     }
 }
@@ -21,17 +34,27 @@ void RCS_Server::TcpConnect_disconnected(const QString &name) {
     logger.warn("client '{}' disconnected", name);
     QMutexLocker lk(&mutex);
     clientList.remove(name);
+    valueCache.remove(name);
+    if (hostAddressRadio) hostAddressRadio->setLoad(clientList.size());
+    advertiseDirectory();
 }
 
 void RCS_Server::TcpConnect_receive_HEAD(TcpConnect *pTcpConnect, const QString &name) {
+    if (pTcpConnect->isPeer()) {
+        logger.info("peer server '{}' Connected", name);
+        setupPeer(pTcpConnect);
+        return;
+    }
+
     QMutexLocker lk(&mutex);
-    if (clientList.contains(name)) {
+    if (clientList.contains(name) || remoteClients.contains(name)) {
         pTcpConnect->send_SERVER_RET({{"error",      "There is already a client with the same name"},
                                       {"disconnect", true}});
         return;
     }
 
     clientList.insert(name, pTcpConnect);
+    if (hostAddressRadio) hostAddressRadio->setLoad(clientList.size());
     logger.info("client '{}' Connected", name);
     connect(pTcpConnect, SIGNAL(Receive_BROADCAST(const QString &, const QString &, const QJsonObject &)),
             this, SLOT(TcpConnect_receive_BROADCAST(const QString &, const QString &, const QJsonObject &)));
@@ -48,26 +71,43 @@ void RCS_Server::TcpConnect_receive_HEAD(TcpConnect *pTcpConnect, const QString
     connect(pTcpConnect, SIGNAL(ServerReceive_CLIENT_RET(const QString &, const QString &, const QJsonObject &)),
             this, SLOT(TcpConnect_receive_CLIENT_RET(const QString &, const QString &, const QJsonObject &)));
 
+    connect(pTcpConnect, SIGNAL(ServerReceive_PUBLISH(const QString &, const QString &, const QJsonObject &)),
+            this, SLOT(TcpConnect_receive_PUBLISH(const QString &, const QString &, const QJsonObject &)));
+
     connect(pTcpConnect, SIGNAL(disconnected(const QString &)),
             this, SLOT(TcpConnect_disconnected(const QString &)));
 
     connect(pTcpConnect, SIGNAL(disconnected(const QString &)),
             this, SIGNAL(ClientDisconnected(const QString &)));
+
+    connect(pTcpConnect, SIGNAL(rttUpdated(const QString &, double)),
+            this, SIGNAL(ClientRttUpdated(const QString &, double)));
     emit NewClient(pTcpConnect->socket->peerAddress(), name);
+    advertiseDirectory();
 }
 
 void RCS_Server::TcpConnect_receive_BROADCAST(const QString &from, const QString &broadcastName,
                                               const QJsonObject &message) {
+    record(TcpConnect::BROADCAST, from, QString(), {{"bordcastName", broadcastName},
+                                                    {"bordcast",     message}});
     emit signal_BROADCAST(from, broadcastName, message);
     for (const auto &client : clientList) {
         if (client->name != from)
             client->send_BROADCAST(from, broadcastName, message);
     }
+    if (!peerList.isEmpty()) {
+        QJsonObject frame = makeForward(TcpConnect::BROADCAST, from, QString());
+        frame.insert("bordcastName", broadcastName);
+        frame.insert("bordcast", message);
+        forwardBroadcast(frame);
+    }
     logger.info("broadcast '{}' from '{}'", broadcastName, from);
 }
 
 void RCS_Server::TcpConnect_receive_PUSH(const QString &from, const QString &sendTo, const QString &var,
                                          const QJsonObject &obj) {
+    record(TcpConnect::PUSH, from, sendTo, {{"var", var},
+                                            {"val", obj}});
     if (sendTo == __NAME__) {
         auto pTcpConnect = clientList.find(from).value();
         auto it = callBackMap.find(var);
@@ -86,8 +126,15 @@ void RCS_Server::TcpConnect_receive_PUSH(const QString &from, const QString &sen
     } else {
         auto it = clientList.find(sendTo);
         if (it != clientList.end()) {
-            it.value()->send_PUSH(sendTo, var, obj);
+            invalidateCache(sendTo, var);
+            it.value()->send_PUSH(from, var, obj);
             logger.info("forwarding PUSH request from '{}' to '{}'", from, sendTo);
+        } else if (remoteClients.contains(sendTo)) {
+            QJsonObject frame = makeForward(TcpConnect::PUSH, from, sendTo);
+            frame.insert("var", var);
+            frame.insert("val", obj);
+            forwardUnicast(frame);
+            logger.info("forwarding PUSH request from '{}' to remote '{}'", from, sendTo);
         } else {
             logger.error("not find client '{}'", sendTo);
             clientList.find(from).value()->send_SERVER_RET({{"error", "not find client '" + sendTo + '\''}});
@@ -97,6 +144,8 @@ void RCS_Server::TcpConnect_receive_PUSH(const QString &from, const QString &sen
 
 void RCS_Server::TcpConnect_receive_GET(const QString &from, const QString &sendTo, const QString &var,
                                         const QJsonObject &info) {
+    record(TcpConnect::GET, from, sendTo, {{"var",  var},
+                                           {"info", info}});
     if (sendTo == __NAME__) {
         auto pTcpConnect = clientList.find(from).value();
         auto it = callBackMap.find(var);
@@ -114,11 +163,19 @@ void RCS_Server::TcpConnect_receive_GET(const QString &from, const QString &send
             logger.error("GET request from '{}', the requested '{}' variable is write only", from,
                          var);
         }
+    } else if (answerFromCache(from, sendTo, var, info)) {
+        logger.info("answer GET request from '{}' to '{}' with cached '{}'", from, sendTo, var);
     } else {
         auto it = clientList.find(sendTo);
         if (it != clientList.end()) {
             it.value()->send_GET(from, var, info);
             logger.info("forwarding GET request from '{}' to '{}'", from, sendTo);
+        } else if (remoteClients.contains(sendTo)) {
+            QJsonObject frame = makeForward(TcpConnect::GET, from, sendTo);
+            frame.insert("var", var);
+            frame.insert("info", info);
+            forwardUnicast(frame);
+            logger.info("forwarding GET request from '{}' to remote '{}'", from, sendTo);
         } else {
             logger.error("not find client '{}'", sendTo);
             clientList.find(from).value()->send_SERVER_RET({{"error", "not find client '" + sendTo + '\''}});
@@ -127,6 +184,7 @@ void RCS_Server::TcpConnect_receive_GET(const QString &from, const QString &send
 }
 
 void RCS_Server::TcpConnect_receive_CLIENT_RET(const QString &from, const QString &sendTo, const QJsonObject &ret) {
+    record(TcpConnect::CLIENT_RET, from, sendTo, {{"ret", ret}});
     if (sendTo == __NAME__) {
         emit signal_RETURN(TcpConnect::CLIENT_RET, ret);
     } else {
@@ -134,22 +192,34 @@ void RCS_Server::TcpConnect_receive_CLIENT_RET(const QString &from, const QStrin
         if (it != clientList.end()) {
             it.value()->send_CLIENT_RET(from, ret);
             logger.info("forwarding CLIENT_RET request from '{}' to '{}'", from, sendTo);
+        } else if (remoteClients.contains(sendTo)) {
+            QJsonObject frame = makeForward(TcpConnect::CLIENT_RET, from, sendTo);
+            frame.insert("ret", ret);
+            forwardUnicast(frame);
+            logger.info("forwarding CLIENT_RET request from '{}' to remote '{}'", from, sendTo);
         } else {
             logger.error("not find client '{}'", sendTo);
-            clientList.find(sendTo).value()->send_SERVER_RET({{"error", "not find client '" + sendTo + '\''}});
+            clientList.find(from).value()->send_SERVER_RET({{"error", "not find client '" + sendTo + '\''}});
         }
     }
 }
 
 RCS_Server::RCS_Server(uint16_t TcpPort, bool udpRadio) : logger(__FUNCTION__) {
-    if (udpRadio) hostAddressRadio = new HostAddressRadio(this);
+    if (udpRadio) hostAddressRadio = new HostAddressRadio(TcpPort, HostAddressRadio::DEFAULT_PORT, this);
     pTcpServer = new QTcpServer(this);
     if (!pTcpServer->listen(QHostAddress::Any, TcpPort)) {
         logger.error("TCP can't listing");
         throw std::runtime_error("TCP can't listing");
     }
     connect(pTcpServer, SIGNAL(newConnection()), this, SLOT(tcpServer_newConnection()));
+    serverName = hostAddressRadio ? QString::number(hostAddressRadio->getServerId(), 16)
+                                  : QString::number(QRandomGenerator::global()->generate(), 16);
+    bootEpoch = QDateTime::currentMSecsSinceEpoch();
+    directoryTimer = new QTimer(this);
+    connect(directoryTimer, SIGNAL(timeout()), this, SLOT(directoryRefresh()));
+    directoryTimer->start(DIRECTORY_REFRESH_INTERVAL);
     RegisterGetCallBack("ClientList", this, &RCS_Server::GET_ClientList);
+    RegisterGetCallBack("ClientRtt", this, &RCS_Server::GET_ClientRtt);
 }
 
 QList<QString> RCS_Server::getClientNameList() {
@@ -165,18 +235,57 @@ bool RCS_Server::disconnect(const QString &name) {
     if (it != clientList.end()) {
         (*it)->deleteLater();
         clientList.erase(it);
+        if (hostAddressRadio) hostAddressRadio->setLoad(clientList.size());
         return true;
     } else return false;
 }
 
 QJsonObject RCS_Server::GET_ClientList(const QString &, const QJsonObject &) {
     QJsonArray array = QJsonArray::fromStringList(getClientNameList());
-    return {{"clientList", array}};
+    QJsonArray remoteArray = QJsonArray::fromStringList(getRemoteClientNameList());
+    return {{"clientList",       array},
+            {"remoteClientList", remoteArray}};
+}
+
+QJsonObject RCS_Server::GET_ClientRtt(const QString &, const QJsonObject &) {
+    QJsonObject rttObject;
+    auto rttMap = getClientRttMap();
+    for (auto it = rttMap.begin(); it != rttMap.end(); ++it)
+        rttObject.insert(it.key(), it.value());
+    return {{"clientRtt", rttObject}};
+}
+
+void RCS_Server::setHeartbeat(int interval, int maxMissed) {
+    QMutexLocker lk(&mutex);
+    heartbeatInterval = interval;
+    heartbeatMaxMissed = maxMissed;
+    for (auto &client : clientList)
+        client->setHeartbeat(interval, maxMissed);
+}
+
+double RCS_Server::getClientRtt(const QString &name) {
+    QMutexLocker lk(&mutex);
+    auto it = clientList.find(name);
+    return it != clientList.end() ? it.value()->getRtt() : -1;
+}
+
+QMap<QString, double> RCS_Server::getClientRttMap() {
+    QMutexLocker lk(&mutex);
+    QMap<QString, double> rttMap;
+    for (auto &client : clientList)
+        rttMap.insert(client->getName(), client->getRtt());
+    return rttMap;
 }
 
 void RCS_Server::BROADCAST(const QString &bordcastName, const QJsonObject &val) {
     for (auto &client : clientList)
         client->send_BROADCAST(__NAME__, bordcastName, val);
+    if (!peerList.isEmpty()) {
+        QJsonObject frame = makeForward(TcpConnect::BROADCAST, __NAME__, QString());
+        frame.insert("bordcastName", bordcastName);
+        frame.insert("bordcast", val);
+        forwardBroadcast(frame);
+    }
 }
 
 void RCS_Server::BROADCAST(const QString &clientName, const QString &bordcastName, const QJsonObject &val) {
@@ -191,6 +300,294 @@ int RCS_Server::UnregisterCallBack(const QString &name) {
 
 void RCS_Server::PUSH(const QString &target, const QString &var, const QJsonObject &val) {
     auto it = clientList.find(target);
-    if (it != clientList.end())
+    if (it != clientList.end()) {
+        invalidateCache(target, var);
         it.value()->send_PUSH(__NAME__, var, val);
+    } else {
+        QJsonObject frame = makeForward(TcpConnect::PUSH, __NAME__, target);
+        frame.insert("var", var);
+        frame.insert("val", val);
+        forwardUnicast(frame);
+    }
+}
+
+void RCS_Server::addPeer(const QHostAddress &addr, uint16_t port) {
+    /* 异步连接，不阻塞事件循环 */
+    QTcpSocket *tcpSocket = new QTcpSocket;
+    connect(tcpSocket, &QTcpSocket::connected, this, [=]() {
+        tcpSocket->disconnect(this);
+        auto pTcpConnect = new TcpConnect(tcpSocket, serverName, true);
+        pTcpConnect->setHeartbeat(heartbeatInterval, heartbeatMaxMissed);
+        peerAddress.insert(pTcpConnect, {addr, port});
+        logger.info("peer server {}:{} Connected", addr, port);
+        setupPeer(pTcpConnect);
+    });
+    /* errorOccurred从Qt 5.15开始提供，之前为重载的error信号 */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    auto errorSignal = &QAbstractSocket::errorOccurred;
+#else
+    auto errorSignal = QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error);
+#endif
+    connect(tcpSocket, errorSignal, this, [=]() {
+        tcpSocket->disconnect(this);
+        logger.error("can't connect peer server {}:{}, {}, retry later", addr, port, tcpSocket->errorString());
+        tcpSocket->deleteLater();
+        QTimer::singleShot(PEER_RETRY_INTERVAL, this, [=]() { addPeer(addr, port); });
+    });
+    tcpSocket->connectToHost(addr, port);
+}
+
+QList<QString> RCS_Server::getRemoteClientNameList() {
+    return remoteClients.keys();
+}
+
+void RCS_Server::setupPeer(TcpConnect *pTcpConnect) {
+    peerList.append(pTcpConnect);
+    connect(pTcpConnect,
+            SIGNAL(PeerReceive_DIRECTORY(TcpConnect * , const QString &, qint64, qint64, const QStringList &)),
+            this,
+            SLOT(TcpConnect_receive_PEER_DIRECTORY(TcpConnect * , const QString &, qint64, qint64,
+                                                   const QStringList &)));
+
+    connect(pTcpConnect, SIGNAL(PeerReceive_FORWARD(TcpConnect * , const QJsonObject &)),
+            this, SLOT(TcpConnect_receive_PEER_FORWARD(TcpConnect * , const QJsonObject &)));
+
+    connect(pTcpConnect, &TcpConnect::disconnected, this, [=]() { Peer_disconnected(pTcpConnect); });
+    sendDirectories(pTcpConnect);
+}
+
+void RCS_Server::advertiseDirectory() {
+    directorySeq++;
+    QStringList clients = clientList.keys();
+    for (auto &peer : peerList)
+        peer->send_PEER_DIRECTORY(serverName, bootEpoch, directorySeq, clients);
+}
+
+void RCS_Server::sendDirectories(TcpConnect *pTcpConnect) {
+    pTcpConnect->send_PEER_DIRECTORY(serverName, bootEpoch, directorySeq, clientList.keys());
+    /* 水平分割，不把从该链接学到的目录发回去 */
+    for (auto it = peerDirectory.begin(); it != peerDirectory.end(); ++it) {
+        if (it->via != pTcpConnect)
+            pTcpConnect->send_PEER_DIRECTORY(it.key(), it->epoch, it->seq, it->clients);
+    }
+}
+
+void RCS_Server::rebuildRemoteClients() {
+    remoteClients.clear();
+    for (auto it = peerDirectory.begin(); it != peerDirectory.end(); ++it) {
+        for (const auto &client : it->clients)
+            remoteClients.insert(client, it.key());
+    }
+}
+
+QJsonObject RCS_Server::makeForward(TcpConnect::PACK_TYPE kind, const QString &from, const QString &sendTo) {
+    QJsonObject frame;
+    frame.insert("kind", kind);
+    frame.insert("from", from);
+    frame.insert("sendTo", sendTo);
+    frame.insert("origin", serverName);
+    frame.insert("epoch", (double) bootEpoch);
+    frame.insert("path", QJsonArray({serverName}));
+    if (kind == TcpConnect::BROADCAST)
+        frame.insert("seq", (double) ++broadcastSeq);
+    return frame;
+}
+
+bool RCS_Server::forwardUnicast(const QJsonObject &frame) {
+    auto server = remoteClients.find(frame.value("sendTo").toString());
+    if (server == remoteClients.end())
+        return false;
+    auto directory = peerDirectory.find(server.value());
+    if (directory == peerDirectory.end())
+        return false;
+    directory->via->send_PEER_FORWARD(frame);
+    return true;
+}
+
+void RCS_Server::forwardBroadcast(const QJsonObject &frame, TcpConnect *except) {
+    for (auto &peer : peerList) {
+        if (peer != except)
+            peer->send_PEER_FORWARD(frame);
+    }
+}
+
+void RCS_Server::TcpConnect_receive_PEER_DIRECTORY(TcpConnect *pTcpConnect, const QString &server, qint64 epoch,
+                                                   qint64 seq, const QStringList &clients) {
+    if (server == serverName)
+        return;
+    auto it = peerDirectory.find(server);
+    if (it != peerDirectory.end() && !isNewer(epoch, seq, it->epoch, it->seq))
+        return;
+    if (it == peerDirectory.end()) {
+        logger.info("learn peer server '{}' with {} clients", server, clients.size());
+        it = peerDirectory.insert(server, {});
+    }
+    it->epoch = epoch;
+    it->seq = seq;
+    it->clients = clients;
+    it->via = pTcpConnect;
+    it->updated.start();
+    rebuildRemoteClients();
+    /* 只转发更新的目录，序号保证不会循环 */
+    for (auto &peer : peerList) {
+        if (peer != pTcpConnect)
+            peer->send_PEER_DIRECTORY(server, epoch, seq, clients);
+    }
+}
+
+void RCS_Server::TcpConnect_receive_PEER_FORWARD(TcpConnect *pTcpConnect, const QJsonObject &frame) {
+    QJsonArray path = frame.value("path").toArray();
+    if (path.contains(serverName))
+        return;
+    QJsonObject next = frame;
+    path.append(serverName);
+    next.insert("path", path);
+
+    auto kind = (TcpConnect::PACK_TYPE) frame.value("kind").toInt(-1);
+    QString from = frame.value("from").toString();
+    QString sendTo = frame.value("sendTo").toString();
+    record(TcpConnect::PEER_FORWARD, from, sendTo, frame);
+
+    if (kind == TcpConnect::BROADCAST) {
+        /* 网状拓扑下广播可能从多条路径到达，按来源服务器序号去重 */
+        QString origin = frame.value("origin").toString();
+        auto epoch = (qint64) frame.value("epoch").toDouble();
+        auto seq = (qint64) frame.value("seq").toDouble();
+        auto last = peerBroadcastSeq.find(origin);
+        /* 来源服务器重启后序号从头开始，以启动标识区分 */
+        if (last != peerBroadcastSeq.end() && !isNewer(epoch, seq, last->first, last->second))
+            return;
+        peerBroadcastSeq.insert(origin, {epoch, seq});
+
+        QString broadcastName = frame.value("bordcastName").toString();
+        QJsonObject message = frame.value("bordcast").toObject();
+        emit signal_BROADCAST(from, broadcastName, message);
+        for (const auto &client : clientList)
+            client->send_BROADCAST(from, broadcastName, message);
+        forwardBroadcast(next, pTcpConnect);
+        logger.info("broadcast '{}' from remote '{}'", broadcastName, from);
+        return;
+    }
+
+    auto it = clientList.find(sendTo);
+    if (it == clientList.end()) {
+        if (!forwardUnicast(next))
+            logger.error("not find client '{}' for {} from remote '{}'", sendTo,
+                         TcpConnect::PACK_TYPE_ToString(kind), from);
+        return;
+    }
+    switch (kind) {
+        case TcpConnect::PUSH:
+            invalidateCache(sendTo, frame.value("var").toString());
+            it.value()->send_PUSH(from, frame.value("var").toString(), frame.value("val").toObject());
+            break;
+        case TcpConnect::GET:
+            if (answerFromCache(from, sendTo, frame.value("var").toString(), frame.value("info").toObject()))
+                return;
+            it.value()->send_GET(from, frame.value("var").toString(), frame.value("info").toObject());
+            break;
+        case TcpConnect::CLIENT_RET:
+            it.value()->send_CLIENT_RET(from, frame.value("ret").toObject());
+            break;
+        default:
+            logger.error("Unknown forward type {}", kind);
+            return;
+    }
+    logger.info("forwarding {} request from remote '{}' to '{}'", TcpConnect::PACK_TYPE_ToString(kind), from, sendTo);
+}
+
+void RCS_Server::Peer_disconnected(TcpConnect *pTcpConnect) {
+    logger.warn("peer server disconnected");
+    peerList.removeAll(pTcpConnect);
+    for (auto it = peerDirectory.begin(); it != peerDirectory.end();) {
+        if (it->via == pTcpConnect) {
+            peerBroadcastSeq.remove(it.key());
+            it = peerDirectory.erase(it);
+        } else ++it;
+    }
+    rebuildRemoteClients();
+    auto addr = peerAddress.find(pTcpConnect);
+    if (addr != peerAddress.end()) {
+        QHostAddress host = addr->first;
+        uint16_t port = addr->second;
+        peerAddress.erase(addr);
+        QTimer::singleShot(PEER_RETRY_INTERVAL, this, [=]() { addPeer(host, port); });
+    }
+}
+
+void RCS_Server::directoryRefresh() {
+    bool changed = false;
+    for (auto it = peerDirectory.begin(); it != peerDirectory.end();) {
+        if (it->updated.hasExpired(DIRECTORY_REFRESH_INTERVAL * 3)) {
+            logger.warn("peer server '{}' directory expired", it.key());
+            peerBroadcastSeq.remove(it.key());
+            it = peerDirectory.erase(it);
+            changed = true;
+        } else ++it;
+    }
+    if (changed)
+        rebuildRemoteClients();
+    advertiseDirectory();
+}
+
+void RCS_Server::TcpConnect_receive_PUBLISH(const QString &from, const QString &var, const QJsonObject &val) {
+    record(TcpConnect::PUBLISH, from, QString(), {{"var", var},
+                                                  {"val", val}});
+    if (cacheFreshness <= 0)
+        return;
+    CacheEntry &entry = valueCache[from][var];
+    entry.val = val;
+    entry.updated.start();
+    logger.debug("'{}' publish '{}'", from, var);
+}
+
+bool RCS_Server::answerFromCache(const QString &from, const QString &sendTo, const QString &var,
+                                 const QJsonObject &info) {
+    if (cacheFreshness <= 0 || !info.isEmpty())
+        return false;
+    auto client = valueCache.find(sendTo);
+    if (client == valueCache.end())
+        return false;
+    auto entry = client->find(var);
+    if (entry == client->end() || entry->updated.hasExpired(cacheFreshness))
+        return false;
+    /* 以目标客户端的名义应答，请求者无法区分缓存应答和客户端应答 */
+    auto it = clientList.find(from);
+    if (it != clientList.end()) {
+        it.value()->send_PUSH(sendTo, var, entry->val);
+    } else {
+        QJsonObject frame = makeForward(TcpConnect::PUSH, sendTo, from);
+        frame.insert("var", var);
+        frame.insert("val", entry->val);
+        forwardUnicast(frame);
+    }
+    return true;
+}
+
+void RCS_Server::invalidateCache(const QString &client, const QString &var) {
+    auto it = valueCache.find(client);
+    if (it != valueCache.end())
+        it->remove(var);
+}
+
+bool RCS_Server::startRecord(const QString &path) {
+    stopRecord();
+    auto newRecorder = new RCS_Recorder;
+    if (!newRecorder->open(path)) {
+        delete newRecorder;
+        return false;
+    }
+    recorder = newRecorder;
+    return true;
+}
+
+void RCS_Server::stopRecord() {
+    if (recorder != nullptr) {
+        delete recorder;
+        recorder = nullptr;
+    }
+}
+
+RCS_Server::~RCS_Server() {
+    stopRecord();
 }
@@ -5,6 +5,7 @@
  */
 
 #include <QJsonObject>
+#include <QJsonArray>
 #include <CRC.h>
 #include "TcpConnect.h"
 
@@ -15,13 +16,17 @@
 #define HASH_LEN 2
 #define ADDI_LED HEAD_LEN + HASH_LEN
 
-TcpConnect::TcpConnect(QTcpSocket *Socket, const QString &_name) : name(_name), logger(__FUNCTION__) {
+TcpConnect::TcpConnect(QTcpSocket *Socket, const QString &_name, bool _peer) :
+        name(_name), logger(__FUNCTION__), peer(_peer) {
     Socket->setParent(this);
     if (name.isEmpty()) {
         timer = new QTimer(this);
         timer->callOnTimeout(this, &::TcpConnect::WaitHEADTimeout);
         timer->start(10e3);
     }
+    heartbeatTimer = new QTimer(this);
+    heartbeatTimer->callOnTimeout(this, &::TcpConnect::HeartbeatTimeout);
+    elapsedTimer.start();
     qThread = new QThread;
     moveToThread(qThread);
     qThread->start();
@@ -41,6 +46,28 @@ TcpConnect::TcpConnect(QTcpSocket *Socket, const QString &_name) : name(_name),
     } else {
         mode = SERVER;
     }
+    setHeartbeat(DEFAULT_HEARTBEAT_INTERVAL, DEFAULT_HEARTBEAT_MAX_MISSED);
+}
+
+void TcpConnect::setHeartbeat(int interval, int maxMissed) {
+    /* 定时器属于链接线程，投递到链接线程执行 */
+    QMetaObject::invokeMethod(this, [=]() {
+        heartbeatMaxMissed = maxMissed;
+        heartbeatMissed = 0;
+        if (interval > 0)
+            heartbeatTimer->start(interval);
+        else heartbeatTimer->stop();
+    }, Qt::QueuedConnection);
+}
+
+void TcpConnect::HeartbeatTimeout() {
+    if (heartbeatMissed++ >= heartbeatMaxMissed) {
+        logger.error("{}: no response for {} heartbeats, disconnect", name, heartbeatMaxMissed);
+        heartbeatTimer->stop();
+        socket->abort();
+        return;
+    }
+    send_HEARTBEAT();
 }
 
 void TcpConnect::write(QByteArray data) {
@@ -63,6 +90,7 @@ void TcpConnect::write(QByteArray data) {
 }
 
 void TcpConnect::Socket_readyRead() {
+    heartbeatMissed = 0;
     ReceiveBuff.push_back(socket->readAll());
     restart:
     auto dataPtr = ReceiveBuff.constData();
@@ -79,10 +107,11 @@ void TcpConnect::Socket_readyRead() {
                 size = ReceiveBuff.size();
             }
             dataPtr = ReceiveBuff.constData();
-            QByteArray Data(dataPtr + i + HEAD_LEN, dataPackSize);
             uint16_t crc = *(uint16_t *)(dataPtr + i + HEAD_LEN + dataPackSize);
-            uint16_t crcCheck = CRC::Verify_CRC16_Check_Sum(Data);
+            /* 直接在接收缓冲区上校验，校验通过才拷贝 */
+            uint16_t crcCheck = CRC::Verify_CRC16_Check_Sum((const uint8_t *) dataPtr + i + HEAD_LEN, dataPackSize);
             if (crc == crcCheck) {
+                QByteArray Data(dataPtr + i + HEAD_LEN, dataPackSize);
                 DecodeJson(Data);
                 ReceiveBuff.remove(0, i + dataPackSize + ADDI_LED);
                 if (ReceiveBuff.size())
@@ -112,6 +141,7 @@ void TcpConnect::DecodeJson(QByteArray &data) {
             }
             if (name.isEmpty()) {
                 name = string;
+                peer = obj.value("peer").toBool(false);
                 setObjectName(string);
                 socket->setObjectName(string + "_Socket");
                 timer->stop();
@@ -179,6 +209,36 @@ void TcpConnect::DecodeJson(QByteArray &data) {
             }
             break;
         }
+        case HEARTBEAT: {
+            send_HEARTBEAT_RET(obj.value("t").toDouble());
+            break;
+        }
+        case HEARTBEAT_RET: {
+            double sample = elapsedTimer.nsecsElapsed() / 1e6 - obj.value("t").toDouble();
+            double srtt = rtt.load();
+            /* RFC 6298 平滑算法 */
+            srtt = srtt < 0 ? sample : srtt * 0.875 + sample * 0.125;
+            rtt.store(srtt);
+            emit rttUpdated(name, srtt);
+            break;
+        }
+        case PEER_DIRECTORY: {
+            QStringList clients;
+            for (const auto &client : obj.value("clients").toArray())
+                clients.append(client.toString());
+            emit PeerReceive_DIRECTORY(this, obj.value("server").toString(), (qint64) obj.value("epoch").toDouble(),
+                                       (qint64) obj.value("seq").toDouble(), clients);
+            break;
+        }
+        case PEER_FORWARD: {
+            emit PeerReceive_FORWARD(this, obj);
+            break;
+        }
+        case PUBLISH: {
+            if (mode == SERVER)
+                emit ServerReceive_PUBLISH(name, obj.value("var").toString(), obj.value("val").toObject());
+            break;
+        }
         default:
             logger.error("Unknown type {}\n{}", type, data);
     }
@@ -205,6 +265,8 @@ void TcpConnect::send_HEAD() {
     QJsonObject obj;
     obj.insert("type", HEAD);
     obj.insert("name", name);
+    if (peer)
+        obj.insert("peer", true);
     write(obj);
 }
 
@@ -258,6 +320,43 @@ void TcpConnect::send_CLIENT_RET(const QString &from_sendTo, const QJsonObject &
     write(obj);
 }
 
+void TcpConnect::send_HEARTBEAT() {
+    QJsonObject obj;
+    obj.insert("type", HEARTBEAT);
+    obj.insert("t", elapsedTimer.nsecsElapsed() / 1e6);
+    write(obj);
+}
+
+void TcpConnect::send_HEARTBEAT_RET(double t) {
+    QJsonObject obj;
+    obj.insert("type", HEARTBEAT_RET);
+    obj.insert("t", t);
+    write(obj);
+}
+
+void TcpConnect::send_PEER_DIRECTORY(const QString &server, qint64 epoch, qint64 seq, const QStringList &clients) {
+    QJsonObject obj;
+    obj.insert("type", PEER_DIRECTORY);
+    obj.insert("server", server);
+    obj.insert("epoch", (double) epoch);
+    obj.insert("seq", (double) seq);
+    obj.insert("clients", QJsonArray::fromStringList(clients));
+    write(obj);
+}
+
+void TcpConnect::send_PEER_FORWARD(QJsonObject frame) {
+    frame.insert("type", PEER_FORWARD);
+    write(frame);
+}
+
+void TcpConnect::send_PUBLISH(const QString &var, const QJsonObject &val) {
+    QJsonObject obj;
+    obj.insert("type", PUBLISH);
+    obj.insert("var", var);
+    obj.insert("val", val);
+    write(obj);
+}
+
 const char *TcpConnect::PACK_TYPE_ToString(TcpConnect::PACK_TYPE type) {
     switch (type) {
         case HEAD:
@@ -274,6 +373,16 @@ const char *TcpConnect::PACK_TYPE_ToString(TcpConnect::PACK_TYPE type) {
             return "CLIENT_RET";
         case DIRECT_LINK:
             return "DIRECT_LINK";
+        case HEARTBEAT:
+            return "HEARTBEAT";
+        case HEARTBEAT_RET:
+            return "HEARTBEAT_RET";
+        case PEER_DIRECTORY:
+            return "PEER_DIRECTORY";
+        case PEER_FORWARD:
+            return "PEER_FORWARD";
+        case PUBLISH:
+            return "PUBLISH";
     }
     return "Unknown";
 }
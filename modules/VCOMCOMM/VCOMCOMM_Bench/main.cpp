@@ -0,0 +1,15 @@
+/**
+ * @file main.cpp
+ * @brief VCOMCOMM伪终端回环测试与吞吐基准主函数
+ */
+
+#include <QCoreApplication>
+#include "main.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("VCOMCOMM_Bench");
+    MyMainThread myMainThread(app.arguments());
+    QObject::connect(&myMainThread, SIGNAL(threadExit()), &app, SLOT(quit()));
+    return app.exec();
+}
@@ -0,0 +1,451 @@
+#ifndef KDROBOTCPPLIBS_VCOMCOMM_BENCH_MAIN_H
+#define KDROBOTCPPLIBS_VCOMCOMM_BENCH_MAIN_H
+
+#include <spdlog/spdlog.h>
+#include <VCOMCOMM.h>
+#include <VCOMCOMMParser.h>
+#include <CRC.h>
+#include <spdlogger.h>
+#include <MainThread.h>
+#include <QCoreApplication>
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <string.h>
+#include <pty.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * 伪终端回环测试与吞吐基准
+ * @brief 用openpty创建伪终端对，主端运行单片机模拟器，从端由VCOMCOMM打开，分三个阶段：
+ *        1. 解析校验：模拟器发送的字节流中混入CRC错误帧、游离的0x5a、超长长度字段和随机字节，
+ *           按随机长度切分或合并写入，检查每个有效帧恰好收到一次且数据一致、解析统计与注入的错误相符
+ *        2. 单片机上报：模拟器按突发模式发送TELEMETRY帧，测量VCOMCOMM收到的帧率、延迟和丢失
+ *        3. 指令回环：VCOMCOMM发送ECHO帧，模拟器原样返回，测量往返帧率、延迟和丢失
+ *        每帧数据前12字节为序号(u32)和发送时间(i64, steady_clock纳秒)，之后为由序号决定的填充；
+ *        任何阶段有丢失、重复、数据不一致或统计不符时进程返回1，可以作为解析器改动的回归测试
+ */
+class MyMainThread : public MainThread {
+Q_OBJECT
+    static const uint8_t TELEMETRY = 0x01;
+    static const uint8_t ECHO = 0x02;
+    static const uint8_t CORRUPTED = 0x03;      //!<@brief CRC错误帧的功能码，不应被收到
+    static const int STAMP_LEN = 12;
+    static const int PARSER_FRAMES = 2000;      //!<@brief 解析校验阶段的最多帧数
+
+    int master = -1;
+    VCOMCOMM *vcom = nullptr;
+    int count = 100000, size = 32, burst = 16, interval = 100;
+
+    QMutex writeMutex;
+    std::atomic<bool> emulatorRunning{false};
+    std::thread emulatorThread;
+
+    QMutex resultMutex;
+    std::vector<int64_t> latency;
+    std::vector<bool> seen;
+    uint64_t duplicated = 0;
+    uint64_t mismatched = 0;                    //!<@brief 长度或数据与发送不一致的帧数
+    uint64_t unexpected = 0;                    //!<@brief 收到的CRC错误帧数
+    int64_t lastReceive = 0;
+
+public:
+
+    MyMainThread(const QStringList &args, QObject *parent = nullptr) : MainThread(args, parent) {
+        QCommandLineParser parser;
+        QCommandLineOption log({"l", "log"}, "Set the log file path. default disable", "log");
+        QCommandLineOption countOption({"n", "count"}, "Frames of each phase, the default is 100000", "count");
+        countOption.setDefaultValue("100000");
+        QCommandLineOption sizeOption({"s", "size"}, "Payload size 12~56, the default is 32", "size");
+        sizeOption.setDefaultValue("32");
+        QCommandLineOption burstOption({"b", "burst"}, "Frames of each burst, the default is 16", "burst");
+        burstOption.setDefaultValue("16");
+        QCommandLineOption intervalOption({"i", "interval"}, "Interval between bursts in us, the default is 100",
+                                          "interval");
+        intervalOption.setDefaultValue("100");
+        QCommandLineOption readerOption({"r", "reader-thread"}, "Service the port with a dedicated reader thread");
+        parser.addHelpOption();
+        parser.addOptions({log, countOption, sizeOption, burstOption, intervalOption, readerOption});
+        parser.process(args);
+        spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [thread %t] [%^%-8l%$]: %v");
+
+        bool Ok1, Ok2, Ok3, Ok4;
+        count = parser.value(countOption).toInt(&Ok1);
+        size = parser.value(sizeOption).toInt(&Ok2);
+        burst = parser.value(burstOption).toInt(&Ok3);
+        interval = parser.value(intervalOption).toInt(&Ok4);
+        if (!(Ok1 && Ok2 && Ok3 && Ok4) || count <= 0 || burst <= 0 || interval < 0 ||
+            size < STAMP_LEN || size > (int) VCOMCOMM::MAX_PAYLOAD) {
+            logger.error("parameter input error");
+            exitOnError();
+            return;
+        }
+
+        /* 从端设为原始模式，防止行规程改写二进制数据 */
+        int slave;
+        char slaveName[64];
+        termios tio = {};
+        cfmakeraw(&tio);
+        if (openpty(&master, &slave, slaveName, &tio, nullptr) != 0) {
+            logger.error("openpty failed: {}", strerror(errno));
+            exitOnError();
+            return;
+        }
+        logger.info("emulator on '{}'", slaveName);
+
+        /* 带有Qt信号量的对象在主线程构造 */
+        vcom = new VCOMCOMM(QString(slaveName), 115200);
+        ::close(slave);
+        if (!vcom->isOpen()) {
+            exitOnError();
+            return;
+        }
+        using namespace std::placeholders;
+        vcom->registerHandler(TELEMETRY, 0, std::bind(&MyMainThread::receive, this, _1, _2));
+        vcom->registerHandler(ECHO, 0, std::bind(&MyMainThread::receive, this, _1, _2));
+        vcom->registerHandler(CORRUPTED, 0, [this](const uint8_t *, uint16_t) {
+            QMutexLocker lk(&resultMutex);
+            unexpected++;
+        });
+        if (parser.isSet(readerOption) && !vcom->startReaderThread()) {
+            exitOnError();
+            return;
+        }
+        this->start();
+    }
+
+    ~MyMainThread() override {
+        if (this->isRunning() && running) {
+            running = false;
+            this->quit();
+            this->wait();
+        }
+        delete vcom;
+        if (master >= 0)
+            ::close(master);
+    }
+
+protected:
+    /**
+     * 构造失败时线程不会启动，threadExit不会发出；测试失败时需要非0返回值。
+     * 排队到事件循环中退出，构造函数在app.exec()之前执行时也有效
+     */
+    static void exitOnError() {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), []() { QCoreApplication::exit(1); },
+                                  Qt::QueuedConnection);
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * 按单片机端格式编码一帧
+     */
+    static QByteArray encode(uint8_t fun_code, uint16_t id, const uint8_t *data, uint16_t len) {
+        QByteArray frame(len + 8, 0);
+        auto p = (uint8_t *) frame.data();
+        p[0] = 0x5a;
+        p[1] = fun_code;
+        memcpy(p + 2, &id, 2);
+        memcpy(p + 4, &len, 2);
+        memcpy(p + 6, data, len);
+        uint16_t crc = len == 0 ? 0 : CRC::Verify_CRC16_Check_Sum(p + 6, len);
+        memcpy(p + 6 + len, &crc, 2);
+        return frame;
+    }
+
+    /**
+     * 填充序号和时间戳之后的数据，接收端据此校验
+     */
+    static void fillPayload(QByteArray &payload, uint32_t seq) {
+        for (int k = STAMP_LEN; k < payload.size(); k++)
+            payload[k] = (char) (seq * 7 + k);
+    }
+
+    /**
+     * 在VCOMCOMM所在线程读取解析统计，读线程模式下为读线程
+     */
+    VCOMCOMMParser::Statistics rxStatistics() {
+        VCOMCOMMParser::Statistics stat;
+        QMetaObject::invokeMethod(vcom, [&]() { stat = vcom->rxStatistics(); }, Qt::BlockingQueuedConnection);
+        return stat;
+    }
+
+    void writeMaster(const QByteArray &data) {
+        QMutexLocker lk(&writeMutex);
+        const char *p = data.constData();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(master, p, left);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                logger.error("write pty failed: {}", strerror(errno));
+                return;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+
+    /**
+     * 单片机模拟器，把收到的ECHO帧原样返回
+     */
+    void emulate() {
+        VCOMCOMMParser parser;
+        uint8_t buff[4096];
+        while (emulatorRunning) {
+            pollfd pfd = {master, POLLIN, 0};
+            if (poll(&pfd, 1, 100) <= 0)
+                continue;
+            ssize_t n = ::read(master, buff, sizeof(buff));
+            if (n <= 0)
+                continue;
+            parser.push(buff, n);
+            VCOMCOMMParser::Frame frame;
+            while (parser.next(frame)) {
+                if (frame.fun_code == ECHO)
+                    writeMaster(encode(ECHO, frame.id, frame.data, frame.len));
+            }
+        }
+        if (parser.statistics().crcErrors || parser.statistics().droppedBytes)
+            logger.warn("emulator: {} CRC errors, {} dropped bytes",
+                        parser.statistics().crcErrors, parser.statistics().droppedBytes);
+    }
+
+    /**
+     * 接收处理，在VCOMCOMM所在线程调用
+     */
+    void receive(const uint8_t *data, uint16_t len) {
+        int64_t t = now();
+        if (len < STAMP_LEN)
+            return;
+        uint32_t seq;
+        int64_t sendTime;
+        memcpy(&seq, data, 4);
+        memcpy(&sendTime, data + 4, 8);
+        bool match = len == size;
+        for (int k = STAMP_LEN; match && k < len; k++)
+            match = data[k] == (uint8_t) (seq * 7 + k);
+        QMutexLocker lk(&resultMutex);
+        if (!match) {
+            mismatched++;
+            return;
+        }
+        if (seq >= seen.size())
+            return;
+        if (seen[seq]) {
+            duplicated++;
+            return;
+        }
+        seen[seq] = true;
+        latency.push_back(t - sendTime);
+        lastReceive = t;
+    }
+
+    /**
+     * 清空接收结果
+     * @param frames 本阶段发送的帧数
+     */
+    void resetResult(int frames) {
+        QMutexLocker lk(&resultMutex);
+        latency.clear();
+        latency.reserve(frames);
+        seen.assign(frames, false);
+        duplicated = 0;
+        mismatched = 0;
+        unexpected = 0;
+        lastReceive = 0;
+    }
+
+    /**
+     * 等待在途帧，1秒内没有新帧视为结束
+     * @param frames 本阶段发送的帧数
+     * @param sendEnd 发送结束时间
+     */
+    void waitReceive(int frames, int64_t sendEnd) {
+        size_t received = 0;
+        while (running) {
+            QThread::msleep(100);
+            QMutexLocker lk(&resultMutex);
+            if (latency.size() == (size_t) frames || (latency.size() == received && now() - sendEnd > 1000000000))
+                break;
+            received = latency.size();
+        }
+    }
+
+    /**
+     * 解析校验阶段，字节流中注入各种错误，按随机长度切分写入
+     * @return 收到的帧和解析统计都与预期一致
+     */
+    bool runParserPhase() {
+        const int frames = std::min(count, PARSER_FRAMES);
+        resetResult(frames);
+        std::mt19937 rng(0x5a);
+        /* 注入的错误数据都不含0x5a，保证解析器丢弃字节数可以精确预期 */
+        auto randomByte = [&rng]() {
+            auto b = (uint8_t) rng();
+            return b == VCOMCOMMParser::SOF ? (uint8_t) 0 : b;
+        };
+        QByteArray stream;
+        uint64_t expectDropped = 0, expectCrcErrors = 0;
+        QByteArray payload(size, 0);
+        for (int i = 0; i < frames; i++) {
+            switch (i % 5) {
+                case 1: {
+                    /* 随机字节 */
+                    int n = 1 + rng() % 20;
+                    for (int k = 0; k < n; k++)
+                        stream.append((char) randomByte());
+                    expectDropped += n;
+                    break;
+                }
+                case 2: {
+                    /* CRC错误帧，数据改动一个字节，CRC不含0x5a */
+                    QByteArray bad(STAMP_LEN + rng() % (VCOMCOMM::MAX_PAYLOAD - STAMP_LEN + 1), 0);
+                    QByteArray frame;
+                    do {
+                        for (auto &c : bad)
+                            c = (char) randomByte();
+                        frame = encode(CORRUPTED, 0, (const uint8_t *) bad.constData(), bad.size());
+                    } while (frame.indexOf((char) VCOMCOMMParser::SOF, 1) >= 0 || (uint8_t) frame[6] == 0x5b);
+                    frame[6] = (char) (frame[6] ^ 0x01);
+                    stream.append(frame);
+                    expectDropped += frame.size();
+                    expectCrcErrors++;
+                    break;
+                }
+                case 3: {
+                    /* 长度字段超过上限的帧头 */
+                    const char head[] = {(char) VCOMCOMMParser::SOF, TELEMETRY, 0, 0, (char) 0xff, (char) 0xff};
+                    stream.append(head, sizeof(head));
+                    expectDropped += sizeof(head);
+                    break;
+                }
+                case 4:
+                    /* 游离的0x5a，与后面的帧头组成的长度字段超过上限 */
+                    stream.append((char) VCOMCOMMParser::SOF);
+                    expectDropped++;
+                    break;
+                default:
+                    break;
+            }
+            uint32_t seq = i;
+            int64_t t = now();
+            memcpy(payload.data(), &seq, 4);
+            memcpy(payload.data() + 4, &t, 8);
+            fillPayload(payload, seq);
+            stream.append(encode(TELEMETRY, 0, (const uint8_t *) payload.constData(), payload.size()));
+        }
+        VCOMCOMMParser::Statistics before = rxStatistics();
+        /* 随机切分，短间隔使部分片段被单独读取，其余在内核缓冲区中合并 */
+        for (int offset = 0; offset < stream.size() && running;) {
+            int n = std::min<int>(stream.size() - offset, 1 + rng() % 150);
+            writeMaster(stream.mid(offset, n));
+            offset += n;
+            if (rng() % 4 == 0)
+                QThread::usleep(200);
+        }
+        waitReceive(frames, now());
+        VCOMCOMMParser::Statistics after = rxStatistics();
+
+        QMutexLocker lk(&resultMutex);
+        uint64_t parsed = after.frames - before.frames;
+        uint64_t dropped = after.droppedBytes - before.droppedBytes;
+        uint64_t crcErrors = after.crcErrors - before.crcErrors;
+        bool ok = latency.size() == (size_t) frames && duplicated == 0 && mismatched == 0 && unexpected == 0 &&
+                  parsed == (uint64_t) frames && dropped == expectDropped && crcErrors == expectCrcErrors;
+        logger.info("parser: {}/{} frames received, {} duplicated, {} mismatched, {} corrupted delivered",
+                    latency.size(), frames, duplicated, mismatched, unexpected);
+        logger.info("parser: parsed {}/{}, dropped bytes {}/{}, CRC errors {}/{}",
+                    parsed, frames, dropped, expectDropped, crcErrors, expectCrcErrors);
+        if (!ok)
+            logger.error("parser: result differs from the injected stream");
+        return ok;
+    }
+
+    /**
+     * 运行一个测量阶段
+     * @param name 阶段名
+     * @param send 发送函数，参数为帧数据
+     * @return 没有丢失、重复和数据不一致
+     */
+    bool runPhase(const char *name, const std::function<void(const QByteArray &)> &send) {
+        resetResult(count);
+        QByteArray payload(size, 0);
+        int64_t begin = now();
+        for (int i = 0; i < count && running; i++) {
+            uint32_t seq = i;
+            int64_t t = now();
+            memcpy(payload.data(), &seq, 4);
+            memcpy(payload.data() + 4, &t, 8);
+            fillPayload(payload, seq);
+            send(payload);
+            if ((i + 1) % burst == 0 && interval > 0)
+                QThread::usleep(interval);
+        }
+        waitReceive(count, now());
+
+        QMutexLocker lk(&resultMutex);
+        if (latency.empty()) {
+            logger.error("{}: nothing received", name);
+            return false;
+        }
+        std::vector<int64_t> sorted = latency;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0;
+        for (int64_t l : sorted)
+            mean += l;
+        mean /= sorted.size();
+        double seconds = (lastReceive - begin) / 1e9;
+        logger.info("{}: {}/{} frames, loss {:.3f}%, {} duplicated, {:.0f} frames/s, {:.2f} MB/s",
+                    name, sorted.size(), count, 100.0 * (count - sorted.size()) / count, duplicated,
+                    sorted.size() / seconds, sorted.size() * (size + 8) / seconds / 1e6);
+        logger.info("{}: latency mean {:.1f}us, p50 {:.1f}us, p99 {:.1f}us, max {:.1f}us", name, mean / 1e3,
+                    sorted[sorted.size() / 2] / 1e3, sorted[sorted.size() * 99 / 100] / 1e3, sorted.back() / 1e3);
+        if (sorted.size() != (size_t) count || duplicated != 0 || mismatched != 0) {
+            logger.error("{}: {} lost, {} duplicated, {} mismatched", name, count - sorted.size(), duplicated,
+                         mismatched);
+            return false;
+        }
+        return true;
+    }
+
+    void main(const QStringList &args) override {
+        emulatorRunning = true;
+        emulatorThread = std::thread(&MyMainThread::emulate, this);
+
+        bool ok = runParserPhase();
+        ok &= runPhase("MCU->PC", [this](const QByteArray &payload) {
+            writeMaster(encode(TELEMETRY, 0, (const uint8_t *) payload.constData(), payload.size()));
+        });
+        ok &= runPhase("PC->MCU->PC", [this](const QByteArray &payload) {
+            vcom->Transmit(ECHO, 0, payload);
+        });
+
+        emulatorRunning = false;
+        emulatorThread.join();
+
+        VCOMCOMM::TxStatistics tx = vcom->txStatistics();
+        logger.info("tx: {} frames, {} dropped, write latency {:.3f}ms, max {:.3f}ms",
+                    tx.frames, tx.droppedFrames, tx.writeLatency, tx.maxWriteLatency);
+        VCOMCOMMParser::Statistics rx = rxStatistics();
+        logger.info("rx: {} frames, {} dropped bytes, {} CRC errors", rx.frames, rx.droppedBytes, rx.crcErrors);
+        if (!ok) {
+            logger.error("FAILED");
+            exitOnError();
+        } else logger.info("PASSED");
+    }
+};
+
+#endif //KDROBOTCPPLIBS_VCOMCOMM_BENCH_MAIN_H
@@ -0,0 +1,80 @@
+/**
+ * @file SPSCRing.h
+ * @brief 单生产者单消费者无锁环形队列
+ */
+
+#ifndef KDROBOTCPPLIBS_SPSCRING_H
+#define KDROBOTCPPLIBS_SPSCRING_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+/**
+ * @brief 单生产者单消费者无锁环形队列
+ * @details 一个线程调用push，另一个线程调用pop，不加锁；
+ *          容量向上取整为2的幂，队列满时push失败，不覆盖未读数据
+ * @tparam T 元素类型，应为POD
+ * @class SPSCRing
+ */
+template<typename T>
+class SPSCRing {
+    std::vector<T> buffer;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};    //!<@brief 下一个写入位置，只由生产者修改
+    alignas(64) std::atomic<size_t> tail{0};    //!<@brief 下一个读取位置，只由消费者修改
+
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 容量，向上取整为2的幂
+     */
+    explicit SPSCRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * @brief 写入一个元素，只能在生产者线程调用
+     * @param item 元素
+     * @return 队列满时返回false
+     */
+    bool push(const T &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask)
+            return false;
+        buffer[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 读出一个元素，只能在消费者线程调用
+     * @param[out] item 元素
+     * @return 队列空时返回false
+     */
+    bool pop(T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        item = buffer[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 当前元素个数，跨线程调用时为近似值
+     */
+    inline size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    inline size_t capacity() const {
+        return mask + 1;
+    }
+};
+
+#endif
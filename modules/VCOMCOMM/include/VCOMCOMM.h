@@ -8,13 +8,33 @@
 #define KDROBOTCPPLIBS_VCOMCOMM_PC_H
 
 #include <QSerialPort>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <vector>
 #include <spdlogger.h>
+#include "VCOMCOMMParser.h"
+#include "SPSCRing.h"
+#include "VCOMCOMMMonitor.h"
 
 /**
  * @brief 虚拟串口
- * @details 可基于PID和VID或制造商名称自动搜索串口
+ * @details 可基于PID和VID或制造商名称自动搜索串口，也可以直接指定串口名
  *          使用VCOMCOMM协议进行通信
- *          基于信号量可跨线程通信
+ *          发送在调用线程编码后进入发送队列，由串口所在线程合并写出，任意线程调用都不会阻塞
+ *          开启分片模式后单条消息最大64KB，自动拆分为FRAGMENT_FUN_CODE分片帧发送并在接收端重组
+ *          可选由独立的读线程服务串口，接收帧带读取时间戳写入无锁环形队列，由使用者轮询读取
+ *          可按(功能码, id)注册处理函数，命中的帧直接在接收缓冲区上分发，不再经过信号和环形队列
+ *          设备拔出后在串口所在线程后台重连，Linux下由热插拔事件触发，断开期间发送的帧保留在发送队列中
  * @class VCOMCOMM
  */
 class VCOMCOMM : public QSerialPort {
@@ -22,8 +42,192 @@ Q_OBJECT
 private:
     uint16_t pid, vid;
     QString manufacturer;
-    Qt::HANDLE thread_id;
+    QString fixedPortName;      //!<@brief 非空时直接打开该串口，不再搜索
     spdlogger logger;
+    VCOMCOMMParser parser;
+
+public:
+    /**
+     * @brief 发送统计
+     */
+    struct TxStatistics {
+        uint64_t frames = 0;            //!<@brief 进入队列的帧数
+        uint64_t droppedFrames = 0;     //!<@brief 队列满或写入串口失败丢弃的帧数
+        size_t queueFrames = 0;         //!<@brief 尚未写出的帧数
+        size_t queueBytes = 0;          //!<@brief 尚未写出的字节数
+        double writeLatency = 0;        //!<@brief 入队到写出的平滑延迟，单位ms
+        double maxWriteLatency = 0;     //!<@brief 入队到写出的最大延迟，单位ms
+    };
+
+    /**
+     * @brief 分片统计
+     */
+    struct FragmentStatistics {
+        uint64_t sentMessages = 0;          //!<@brief 分片发送的消息数
+        uint64_t sentFragments = 0;         //!<@brief 发送的分片数
+        uint64_t receivedMessages = 0;      //!<@brief 重组成功的消息数
+        uint64_t receivedFragments = 0;     //!<@brief 接收的分片数
+        uint64_t droppedMessages = 0;       //!<@brief 分片丢失而放弃重组的消息数
+        uint64_t invalidFragments = 0;      //!<@brief 格式错误的分片数
+        uint64_t evictedMessages = 0;       //!<@brief 超时或超出数量上限而放弃重组的消息数
+    };
+
+    static const size_t MAX_PAYLOAD = 64 - 8;                   //!<@brief 单帧最大数据长度
+
+    /**
+     * @brief 读线程模式下写入环形队列的接收帧
+     */
+    struct RxFrame {
+        int64_t timestamp;              //!<@brief 读取时间，steady_clock纳秒
+        uint8_t fun_code;               //!<@brief 功能码
+        uint16_t id;                    //!<@brief 消息ID
+        uint16_t len;                   //!<@brief 数据长度
+        uint8_t data[MAX_PAYLOAD];      //!<@brief 数据
+    };
+
+    static const size_t DEFAULT_RING_CAPACITY = 1024;           //!<@brief 默认环形队列容量，单位帧
+    static const int RECONNECT_INTERVAL = 500;          //!<@brief 没有热插拔事件时的重连间隔，单位ms
+    static const int RECONNECT_BACKSTOP = 2000;         //!<@brief 有热插拔事件时的兜底重连间隔，单位ms
+    static const int RECONNECT_FAST_INTERVAL = 20;      //!<@brief 设备增加后等待设备节点就绪的重试间隔，单位ms
+    static const int RECONNECT_FAST_RETRIES = 50;       //!<@brief 设备增加后快速重试次数
+
+    /**
+     * @brief 帧处理函数，data指向接收缓冲区，仅在调用期间有效
+     */
+    using FrameHandler = std::function<void(const uint8_t *data, uint16_t len)>;
+    static const size_t DEFAULT_TX_QUEUE_LIMIT = 128 * 1024;    //!<@brief 默认发送队列上限，单位字节
+    static const uint8_t FRAGMENT_FUN_CODE = 0xFE;              //!<@brief 分片帧功能码，分片模式下保留
+    static const size_t FRAGMENT_HEAD_LEN = 6;                  //!<@brief 分片头长度
+    static const size_t FRAGMENT_PAYLOAD = MAX_PAYLOAD - FRAGMENT_HEAD_LEN;    //!<@brief 每个分片携带的数据长度
+    static const size_t MAX_MESSAGE_SIZE = 65535;               //!<@brief 分片模式下单条消息最大长度
+    static const int REASSEMBLY_TIMEOUT = 1000;                 //!<@brief 重组中的消息多久没有收到新分片后放弃，单位ms
+    static const size_t MAX_REASSEMBLY = 32;                    //!<@brief 同时重组的消息数上限
+
+private:
+    /**
+     * @brief 入队时间，用于计算写出延迟
+     */
+    struct TxMark {
+        uint64_t end;       //!<@brief 帧末尾在发送流中的偏移
+        qint64 time;        //!<@brief 入队时间，单位ns
+    };
+
+    QMutex txMutex;
+    QByteArray txQueue;                         //!<@brief 等待写入串口的数据
+    std::deque<TxMark> txMarks;                 //!<@brief 未写出帧的入队时间
+    uint64_t txEnqueuedBytes = 0;               //!<@brief 累计入队字节数
+    uint64_t txWrittenBytes = 0;                //!<@brief 累计写出字节数
+    size_t txQueueLimit = DEFAULT_TX_QUEUE_LIMIT;
+    TxStatistics txStat;
+    QElapsedTimer txClock;
+    std::atomic<bool> flushScheduled{false};
+
+    /**
+     * @brief 正在重组的消息，以(原功能码, id)区分
+     */
+    struct Reassembly {
+        uint8_t seq;                    //!<@brief 消息序号
+        uint16_t count;                 //!<@brief 分片总数
+        uint16_t received;              //!<@brief 已收到的分片数
+        uint16_t lastLen;               //!<@brief 最后一个分片的长度
+        qint64 lastTime;                //!<@brief 最近收到分片的时间，单位ns
+        std::vector<bool> got;          //!<@brief 各分片是否已收到
+        QByteArray data;
+    };
+
+    std::atomic<bool> fragmentation{false};
+    std::atomic<uint8_t> txMessageSeq{0};
+    std::map<uint32_t, Reassembly> reassembly;
+    QMutex fragStatMutex;
+    FragmentStatistics fragStat;        //!<@brief 由fragStatMutex保护
+
+    QThread *readerThread = nullptr;
+    bool ringMode = false;              //!<@brief 只在串口所在线程访问
+    std::unique_ptr<SPSCRing<RxFrame>> rxRing;
+    std::atomic<uint64_t> ringDropped{0};
+
+    /**
+     * @brief 在读线程内设置实时调度和CPU亲和性
+     */
+    void setupReaderThread(int priority, int cpu);
+
+    /**
+     * @brief 分发表，功能码 -> id高字节 -> id低字节，二三级按需分配
+     */
+    using HandlerPage = std::array<FrameHandler, 256>;
+    std::array<std::unique_ptr<std::array<std::unique_ptr<HandlerPage>, 256>>, 256> handlers;
+    uint64_t dispatchSizeErrors = 0;
+
+    /**
+     * @brief 查表分发
+     * @return 有注册的处理函数
+     */
+    inline bool dispatch(uint8_t fun_code, uint16_t id, const uint8_t *data, uint16_t len) {
+        const auto &table = handlers[fun_code];
+        if (!table)
+            return false;
+        const auto &page = (*table)[id >> 8];
+        if (!page)
+            return false;
+        const FrameHandler &handler = (*page)[id & 0xff];
+        if (!handler)
+            return false;
+        handler(data, len);
+        return true;
+    }
+
+    VCOMCOMMMonitor *monitor = nullptr;
+    QTimer *reconnectTimer = nullptr;
+    int fastRetries = 0;
+
+    void init();
+
+    /**
+     * @brief 开始后台重连
+     * @param fast 刚收到设备增加事件，短间隔重试
+     */
+    void startReconnect(bool fast);
+
+    /**
+     * @brief 串口失效，关闭串口并开始后台重连，发送队列保留
+     */
+    void portLost();
+
+    /**
+     * @brief 编码一帧并追加到out
+     */
+    static void encodeFrame(QByteArray &out, uint8_t fun_code, uint16_t id, const char *data, uint16_t len);
+
+    /**
+     * @brief 把编码好的帧整体放入发送队列，队列空间不足时全部丢弃
+     * @param frames 编码好的帧
+     * @param ends 各帧末尾在frames中的偏移
+     * @return 是否入队
+     */
+    bool enqueue(const QByteArray &frames, const std::vector<int> &ends);
+
+    /**
+     * @brief 处理收到的分片帧
+     */
+    void receiveFragment(uint16_t id, const uint8_t *data, uint16_t len);
+
+    /**
+     * @brief 放弃超时的重组，数量达到上限时再放弃最久没有进展的一条，为新消息腾出位置
+     * @param now 当前时间，单位ns
+     */
+    void evictReassembly(qint64 now);
+
+    /**
+     * @brief 丢弃串口内部缓冲区中尚未写出的数据的记录，关闭串口前调用
+     */
+    void discardWriteBuffer();
+
+    /**
+     * @brief 从发送字节流中剔除写入串口失败的数据，并丢弃其中的帧记录
+     * @param handedEnd 交给串口的数据在字节流中的结束位置
+     * @param bytes 写入失败的字节数，位于handedEnd之前
+     */
+    void dropUnwritten(uint64_t handedEnd, uint64_t bytes);
 
 public:
 
@@ -40,10 +244,21 @@ public:
      */
     VCOMCOMM(const QString &manufacturer, QObject *parent = nullptr);
 
+    /**
+     * @brief 构造函数,直接打开指定串口，用于非USB设备或伪终端
+     * @param portName 串口名或设备路径，如"/dev/ttyUSB0"、"COM3"
+     * @param baudRate 波特率
+     */
+    VCOMCOMM(const QString &portName, qint32 baudRate, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，读线程运行时先停止读线程
+     */
+    ~VCOMCOMM() override;
 
     /**
      * @brief 自动连接对应制造商名称或PID和VID的USB串口设备
-     *        优先搜索制造商名称
+     *        优先搜索制造商名称，构造时指定了串口名则直接打开该串口
      * @return 自动连接是否成功
      */
     bool auto_connect();
@@ -61,16 +276,150 @@ public:
      */
     void setManufacturer(const QString &manufacturer);
 
+    /**
+     * @brief 获取接收统计，只能在串口所在线程调用
+     * @return 解析成功帧数、同步丢弃字节数、CRC错误帧数
+     */
+    inline const VCOMCOMMParser::Statistics &rxStatistics() const {
+        return parser.statistics();
+    }
+
+    /**
+     * @brief 获取发送统计，可跨线程调用
+     * @return 发送统计
+     */
+    TxStatistics txStatistics();
+
+    /**
+     * @brief 设置发送队列上限，超过上限的新帧被丢弃，可跨线程调用
+     * @param bytes 上限，单位字节
+     */
+    void setTxQueueLimit(size_t bytes);
+
+    /**
+     * @brief 设置分片模式，需要单片机端同样支持
+     * @details 开启后超过MAX_PAYLOAD的消息拆分为功能码FRAGMENT_FUN_CODE的分片帧发送，
+     *          收到的分片帧重组后以原功能码发出receiveData；关闭时超长消息抛出异常
+     * @param enable 是否开启
+     */
+    void setFragmentation(bool enable);
+
+    inline bool isFragmentation() const {
+        return fragmentation;
+    }
+
+    /**
+     * @brief 获取分片统计，可跨线程调用
+     * @return 分片统计
+     */
+    FragmentStatistics fragmentStatistics();
+
+    /**
+     * @brief 启动读线程模式，只能在对象所在线程调用，对象不能有父对象
+     * @details 对象移动到独立线程，串口读写都在该线程完成，接收帧不再发出receiveData，
+     *          而是带读取时间戳写入环形队列，使用readFrame读取；分片重组后的消息仍通过receiveData发出
+     * @param ringCapacity 环形队列容量，单位帧
+     * @param priority SCHED_FIFO优先级，0使用普通调度，仅Linux有效
+     * @param cpu 绑定的CPU序号，-1不绑定，仅Linux有效
+     * @return 启动成功
+     */
+    bool startReaderThread(size_t ringCapacity = DEFAULT_RING_CAPACITY, int priority = 0, int cpu = -1);
+
+    /**
+     * @brief 停止读线程，对象移回调用线程，恢复receiveData信号
+     */
+    void stopReaderThread();
+
+    inline bool isReaderThreadRunning() const {
+        return readerThread != nullptr;
+    }
+
+    /**
+     * @brief 从环形队列读取一帧，只能由一个消费者线程调用
+     * @param[out] frame 接收帧
+     * @return 队列空时返回false
+     */
+    inline bool readFrame(RxFrame &frame) {
+        return rxRing && rxRing->pop(frame);
+    }
+
+    /**
+     * @brief 环形队列满而丢弃的帧数
+     */
+    inline uint64_t ringDroppedFrames() const {
+        return ringDropped;
+    }
+
+    /**
+     * @brief 注册(功能码, id)的处理函数，替换已有的处理函数
+     * @note 只能在串口所在线程调用，读线程模式下应在startReaderThread之前注册
+     * @param fun_code 功能码
+     * @param id 消息ID
+     * @param handler 处理函数，为空时等同于unregisterHandler
+     */
+    void registerHandler(uint8_t fun_code, uint16_t id, const FrameHandler &handler);
+
+    /**
+     * @brief 注册类型化处理函数，数据长度等于sizeof(T)时解码为T后调用，否则丢弃并计数
+     * @tparam T 紧凑排列的POD结构体，与单片机端定义一致
+     * @param fun_code 功能码
+     * @param id 消息ID
+     * @param handler 处理函数，参数为const T &
+     */
+    template<typename T, typename F>
+    void registerHandler(uint8_t fun_code, uint16_t id, F handler) {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        uint64_t *sizeErrors = &dispatchSizeErrors;
+        registerHandler(fun_code, id, [handler, sizeErrors](const uint8_t *data, uint16_t len) {
+            if (len != sizeof(T)) {
+                (*sizeErrors)++;
+                return;
+            }
+            T val;
+            memcpy(&val, data, sizeof(T));
+            handler(val);
+        });
+    }
+
+    /**
+     * @brief 注销(功能码, id)的处理函数，之后该帧恢复通过receiveData或环形队列发出
+     * @param fun_code 功能码
+     * @param id 消息ID
+     */
+    void unregisterHandler(uint8_t fun_code, uint16_t id);
+
+    /**
+     * @brief 类型化处理函数因数据长度不符丢弃的帧数，只能在串口所在线程调用
+     */
+    inline uint64_t dispatchSizeErrorCount() const {
+        return dispatchSizeErrors;
+    }
+
 protected slots:
 
     void portReadyRead();
 
     void portErrorOccurred(QSerialPort::SerialPortError error);
 
+    void portBytesWritten(qint64 bytes);
+
+    void reconnect();
+
+    void deviceAdded(const QString &devName);
+
+    void deviceRemoved(const QString &devName);
+
+    /**
+     * @brief 在串口所在线程把发送队列一次性写入串口
+     */
+    void flushTxQueue();
+
 public slots:
 
     /**
-     * @brief 发送消息
+     * @brief 发送消息，可跨线程调用，不会阻塞
+     * @details 帧在调用线程编码后进入发送队列，队列满时丢弃该帧，
+     *          分片模式下一条消息的所有分片同时入队或同时丢弃
      * @param fun_code 功能码
      * @param id 消息ID
      * @param data 数据
@@ -86,14 +435,6 @@ signals:
      * @param data 数据
      */
     void receiveData(uint8_t fun_code, uint16_t id, const QByteArray &data);
-
-    /**
-     * @brief 通过信号量实现跨线程发送
-     * @param fun_code 功能码
-     * @param id 消息ID
-     * @param data 数据
-     */
-    void CrossThreadTransmitSignal(uint8_t fun_code, uint16_t id, const QByteArray &data);
 };
 
 
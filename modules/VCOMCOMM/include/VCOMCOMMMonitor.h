@@ -0,0 +1,56 @@
+/**
+ * @file VCOMCOMMMonitor.h
+ * @brief 串口设备热插拔监视
+ */
+
+#ifndef KDROBOTCPPLIBS_VCOMCOMMMONITOR_H
+#define KDROBOTCPPLIBS_VCOMCOMMMONITOR_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <spdlogger.h>
+
+/**
+ * @brief 串口设备热插拔监视器
+ * @details Linux下监听内核NETLINK_KOBJECT_UEVENT消息，tty子系统的设备增加或移除时发出信号，
+ *          不需要枚举串口；其他平台或创建netlink套接字失败时isAvailable返回false，由使用者轮询
+ * @class VCOMCOMMMonitor
+ */
+class VCOMCOMMMonitor : public QObject {
+Q_OBJECT
+    spdlogger logger;
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+
+public:
+    explicit VCOMCOMMMonitor(QObject *parent = nullptr);
+
+    ~VCOMCOMMMonitor() override;
+
+    /**
+     * @brief 是否可以收到热插拔事件
+     */
+    inline bool isAvailable() const {
+        return fd >= 0;
+    }
+
+protected slots:
+
+    void socketActivated();
+
+signals:
+
+    /**
+     * @brief tty设备增加
+     * @param devName 设备名，如"ttyACM0"
+     */
+    void deviceAdded(const QString &devName);
+
+    /**
+     * @brief tty设备移除
+     * @param devName 设备名，如"ttyACM0"
+     */
+    void deviceRemoved(const QString &devName);
+};
+
+#endif
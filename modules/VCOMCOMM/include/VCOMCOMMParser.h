@@ -0,0 +1,85 @@
+/**
+ * @file VCOMCOMMParser.h
+ * @brief VCOMCOMM协议流式解析
+ */
+
+#ifndef KDROBOTCPPLIBS_VCOMCOMMPARSER_H
+#define KDROBOTCPPLIBS_VCOMCOMMPARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief VCOMCOMM协议流式解析器
+ * @details 帧格式: 0x5a | fun_code(1) | id(2) | len(2) | data(len) | crc16(2)
+ *          数据可以任意切分后按顺序送入，解析器保留不完整的帧，
+ *          遇到非法帧头或CRC错误时丢弃一个字节后重新搜索0x5a同步
+ * @class VCOMCOMMParser
+ */
+class VCOMCOMMParser {
+public:
+    static const uint8_t SOF = 0x5a;            //!<@brief 帧头
+    static const size_t HEAD_LEN = 6;           //!<@brief 帧头长度
+    static const size_t FRAME_OVERHEAD = 8;     //!<@brief 帧头加CRC长度
+    static const size_t MAX_PACKET = 64;        //!<@brief 单片机端单帧最大长度
+
+    /**
+     * @brief 解析出的帧，data指向解析器内部缓冲区，下一次调用push前有效
+     */
+    struct Frame {
+        uint8_t fun_code;       //!<@brief 功能码
+        uint16_t id;            //!<@brief 消息ID
+        uint16_t len;           //!<@brief 数据长度
+        const uint8_t *data;    //!<@brief 数据
+    };
+
+    /**
+     * @brief 统计计数
+     */
+    struct Statistics {
+        uint64_t frames = 0;        //!<@brief 解析成功的帧数
+        uint64_t droppedBytes = 0;  //!<@brief 同步时丢弃的字节数
+        uint64_t crcErrors = 0;     //!<@brief CRC校验失败的帧数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param maxPayload 允许的最大数据长度，超过视为非法帧头
+     */
+    explicit VCOMCOMMParser(uint16_t maxPayload = MAX_PACKET - FRAME_OVERHEAD) : maxPayload(maxPayload) {}
+
+    /**
+     * @brief 送入接收到的数据
+     * @param data 数据
+     * @param len 长度
+     */
+    void push(const uint8_t *data, size_t len);
+
+    /**
+     * @brief 取出下一个完整帧
+     * @param[out] frame 帧
+     * @return 是否取到完整帧，返回false时剩余数据保留等待下一次push
+     */
+    bool next(Frame &frame);
+
+    /**
+     * @brief 清空缓冲区，用于重新打开串口后
+     */
+    inline void reset() {
+        buffer.clear();
+        pos = 0;
+    }
+
+    inline const Statistics &statistics() const {
+        return stat;
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t pos = 0;             //!<@brief 未解析数据起始位置
+    uint16_t maxPayload;
+    Statistics stat;
+};
+
+#endif
@@ -8,75 +8,173 @@
 #include "VCOMCOMM.h"
 
 #include <QSerialPortInfo>
+#include <QFileInfo>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
 #include "CRC.h"
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 VCOMCOMM::VCOMCOMM(uint16_t PID, uint16_t VID, QObject *parent) : QSerialPort(parent), logger(__FUNCTION__) {
     pid = PID;
     vid = VID;
-    thread_id = QThread::currentThreadId();
-    connect(this, &QSerialPort::readyRead, this, &VCOMCOMM::portReadyRead);
-    connect(this, &QSerialPort::errorOccurred, this, &VCOMCOMM::portErrorOccurred);
-    connect(this, &VCOMCOMM::CrossThreadTransmitSignal, this, &VCOMCOMM::Transmit, Qt::QueuedConnection);
-    if (!auto_connect())
+    init();
+    if (!auto_connect()) {
         logger.warn("not find VCOMCOMM Device");
+        startReconnect(false);
+    }
 }
 
 VCOMCOMM::VCOMCOMM(const QString &manufacturer, QObject *parent)
-        : QSerialPort(parent), logger(__FUNCTION__), manufacturer(manufacturer) {
+        : QSerialPort(parent), manufacturer(manufacturer), logger(__FUNCTION__) {
+    pid = vid = 0;
+    init();
+    if (!auto_connect()) {
+        logger.warn("not find VCOMCOMM Device");
+        startReconnect(false);
+    }
+}
+
+VCOMCOMM::VCOMCOMM(const QString &portName, qint32 baudRate, QObject *parent)
+        : QSerialPort(parent), fixedPortName(portName), logger(__FUNCTION__) {
     pid = vid = 0;
-    thread_id = QThread::currentThreadId();
+    init();
+    this->setBaudRate(baudRate);
+    if (!auto_connect()) {
+        logger.warn("can't open port '{}'", portName);
+        startReconnect(false);
+    }
+}
+
+VCOMCOMM::~VCOMCOMM() {
+    stopReaderThread();
+}
+
+void VCOMCOMM::init() {
+    txClock.start();
     connect(this, &QSerialPort::readyRead, this, &VCOMCOMM::portReadyRead);
     connect(this, &QSerialPort::errorOccurred, this, &VCOMCOMM::portErrorOccurred);
-    connect(this, &VCOMCOMM::CrossThreadTransmitSignal, this, &VCOMCOMM::Transmit, Qt::QueuedConnection);
-    if (!auto_connect())
-        logger.warn("not find VCOMCOMM Device");
+    connect(this, &QSerialPort::bytesWritten, this, &VCOMCOMM::portBytesWritten);
+    /* 作为子对象随串口一起移动到读线程 */
+    monitor = new VCOMCOMMMonitor(this);
+    connect(monitor, &VCOMCOMMMonitor::deviceAdded, this, &VCOMCOMM::deviceAdded);
+    connect(monitor, &VCOMCOMMMonitor::deviceRemoved, this, &VCOMCOMM::deviceRemoved);
+    reconnectTimer = new QTimer(this);
+    connect(reconnectTimer, &QTimer::timeout, this, &VCOMCOMM::reconnect);
+}
+
+void VCOMCOMM::startReconnect(bool fast) {
+    fastRetries = fast ? RECONNECT_FAST_RETRIES : 0;
+    if (fast)
+        reconnectTimer->start(RECONNECT_FAST_INTERVAL);
+    else
+        reconnectTimer->start(monitor->isAvailable() ? RECONNECT_BACKSTOP : RECONNECT_INTERVAL);
+}
+
+void VCOMCOMM::reconnect() {
+    if (this->isOpen() || auto_connect()) {
+        reconnectTimer->stop();
+        /* 发出断开期间缓存的帧 */
+        if (!flushScheduled.exchange(true))
+            flushTxQueue();
+        return;
+    }
+    if (fastRetries > 0 && --fastRetries == 0)
+        startReconnect(false);
+}
+
+void VCOMCOMM::portLost() {
+    if (this->isOpen()) {
+        logger.warn("port '{}' lost, reconnect in background", this->portName());
+        discardWriteBuffer();
+        reassembly.clear();
+        this->close();
+    }
+    if (!reconnectTimer->isActive())
+        startReconnect(false);
+}
+
+void VCOMCOMM::deviceAdded(const QString &devName) {
+    if (this->isOpen())
+        return;
+    reconnect();
+    if (!this->isOpen())
+        startReconnect(true);
+}
+
+void VCOMCOMM::deviceRemoved(const QString &devName) {
+    if (this->isOpen() && QFileInfo(this->portName()).fileName() == devName)
+        portLost();
 }
 
 bool VCOMCOMM::auto_connect() {
-    QSerialPortInfo selected_port;
-    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts()) {
-        if (manufacturer.isEmpty()) {
-            if (info.hasVendorIdentifier() && info.hasProductIdentifier() &&
-                info.vendorIdentifier() == vid && info.productIdentifier() == pid) {
+    QString portName = fixedPortName;
+    if (portName.isEmpty()) {
+        QSerialPortInfo selected_port;
+        for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts()) {
+            if (manufacturer.isEmpty()) {
+                if (info.hasVendorIdentifier() && info.hasProductIdentifier() &&
+                    info.vendorIdentifier() == vid && info.productIdentifier() == pid) {
+                    selected_port = info;
+                }
+            } else if (info.manufacturer() == manufacturer) {
                 selected_port = info;
             }
-        } else if (info.manufacturer() == manufacturer) {
-            selected_port = info;
         }
-    }
-    if (!selected_port.isNull()) {
+        if (selected_port.isNull())
+            return false;
         logger.info("find VCOMCOMM Driver, Port:'{}', Manufacturer:'{}'",
                     selected_port.portName(), selected_port.manufacturer());
-        if (this->isOpen()) {
-            logger.info("close port and reopen");
-            this->close();
-        } else logger.info("open port");
-        this->setPort(selected_port);
-        if (this->open(ReadWrite) && (this->error() == SerialPortError::NoError))
-            return true;
-        else logger.error("can't open port {}", selected_port.portName());
+        portName = selected_port.systemLocation();
     }
+    if (this->isOpen()) {
+        logger.info("close port and reopen");
+        discardWriteBuffer();
+        reassembly.clear();
+        this->close();
+    } else logger.info("open port");
+    this->setPortName(portName);
+    parser.reset();
+    if (this->open(ReadWrite) && (this->error() == SerialPortError::NoError))
+        return true;
+    else logger.error("can't open port {}", portName);
     return false;
 }
 
 void VCOMCOMM::portReadyRead() {
     QByteArray data = this->readAll();
-    this->clear(Input);
-    uint8_t *pdata = (uint8_t *) data.data();
-    if (pdata[0] == 0x5a) {
-        uint8_t fun = pdata[1];
-        uint16_t id = *((uint16_t *) (pdata + 2));
-        uint16_t len = *((uint16_t *) (pdata + 4));
-        if (len + 8 != data.size())
-            return;
-        uint16_t crc = *((uint16_t *) (pdata + 6 + len));
-        QByteArray array((const char *) (pdata + 6), len);
-        uint16_t c = CRC::Verify_CRC16_Check_Sum(array);
-        if (len == 0 || c == crc) {
-            logger.debug("RX: fun=0x{:02X}, id=0x{:04X}, crc=0x{:04X}|0x{:04X}", fun, id, crc, c);
-            emit receiveData(fun, id, array);
-        } else logger.warn("RX: fun=0x{:02X}, id=0x{:04X}, crc=0x{:04X}|0x{:04X} CRC Error", fun, id, crc, c);
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t crcErrors = parser.statistics().crcErrors;
+    parser.push((const uint8_t *) data.constData(), data.size());
+    VCOMCOMMParser::Frame frame;
+    while (parser.next(frame)) {
+        if (fragmentation && frame.fun_code == FRAGMENT_FUN_CODE) {
+            receiveFragment(frame.id, frame.data, frame.len);
+            continue;
+        }
+        if (dispatch(frame.fun_code, frame.id, frame.data, frame.len))
+            continue;
+        if (ringMode) {
+            RxFrame rx;
+            rx.timestamp = timestamp;
+            rx.fun_code = frame.fun_code;
+            rx.id = frame.id;
+            rx.len = frame.len;
+            memcpy(rx.data, frame.data, frame.len);
+            if (!rxRing->push(rx))
+                ringDropped++;
+            continue;
+        }
+        logger.debug("RX: fun=0x{:02X}, id=0x{:04X}, len={}", frame.fun_code, frame.id, frame.len);
+        emit receiveData(frame.fun_code, frame.id, QByteArray((const char *) frame.data, frame.len));
     }
+    if (parser.statistics().crcErrors != crcErrors)
+        logger.warn("RX: {} CRC Error", parser.statistics().crcErrors - crcErrors);
 }
 
 void VCOMCOMM::portErrorOccurred(SerialPortError error) {
@@ -84,36 +182,269 @@ void VCOMCOMM::portErrorOccurred(SerialPortError error) {
         QMetaEnum metaEnum = QMetaEnum::fromType<SerialPortError>();
         logger.error("{}", metaEnum.valueToKey(error));
     }
+    /* 设备被拔出 */
+    if (error == ResourceError)
+        QMetaObject::invokeMethod(this, [this]() { portLost(); }, Qt::QueuedConnection);
+}
+
+void VCOMCOMM::encodeFrame(QByteArray &out, uint8_t fun_code, uint16_t id, const char *data, uint16_t len) {
+    uint8_t buff[64] = {0x5a, fun_code};
+    *((uint16_t *) (buff + 2)) = id;
+    *((uint16_t *) (buff + 4)) = len;
+    memcpy(buff + 6, data, len);
+    *((uint16_t *) (buff + 6 + len)) = (len == 0) ? 0 : CRC::Verify_CRC16_Check_Sum(buff + 6, len);
+    out.append((const char *) buff, len + 8);
+}
+
+bool VCOMCOMM::enqueue(const QByteArray &frames, const std::vector<int> &ends) {
+    QMutexLocker lk(&txMutex);
+    if (txEnqueuedBytes - txWrittenBytes + frames.size() > txQueueLimit) {
+        txStat.droppedFrames += ends.size();
+        return false;
+    }
+    qint64 now = txClock.nsecsElapsed();
+    for (int end : ends)
+        txMarks.push_back({txEnqueuedBytes + end, now});
+    txQueue.append(frames);
+    txEnqueuedBytes += frames.size();
+    txStat.frames += ends.size();
+    if (ends.size() > 1) {
+        QMutexLocker statLk(&fragStatMutex);
+        fragStat.sentMessages++;
+        fragStat.sentFragments += ends.size();
+    }
+    return true;
 }
 
 void VCOMCOMM::Transmit(uint8_t fun_code, uint16_t id, const QByteArray &data) {
-    if (thread_id != QThread::currentThreadId()) {
-        emit CrossThreadTransmitSignal(fun_code, id, data);
+    size_t size = data.size();
+    bool fragment = fragmentation && (size > MAX_PAYLOAD || fun_code == FRAGMENT_FUN_CODE);
+    if ((!fragment && size > MAX_PAYLOAD) || size > MAX_MESSAGE_SIZE) {
+        logger.error("VCOMCOMM out of range len={}", size);
+        throw std::runtime_error("VCOMCOMM out of range");
+    }
+    QByteArray frames;
+    std::vector<int> ends;
+    if (!fragment) {
+        encodeFrame(frames, fun_code, id, data.constData(), size);
+        ends.push_back(frames.size());
+    } else {
+        /* 分片头: 原功能码(1) | 消息序号(1) | 分片序号(2) | 分片总数(2) */
+        uint16_t count = size == 0 ? 1 : (size + FRAGMENT_PAYLOAD - 1) / FRAGMENT_PAYLOAD;
+        uint8_t seq = txMessageSeq++;
+        frames.reserve(count * (MAX_PAYLOAD + 8));
+        ends.reserve(count);
+        char buff[MAX_PAYLOAD] = {(char) fun_code, (char) seq};
+        for (uint16_t i = 0; i < count; i++) {
+            size_t offset = i * FRAGMENT_PAYLOAD;
+            size_t len = size - offset < FRAGMENT_PAYLOAD ? size - offset : (size_t) FRAGMENT_PAYLOAD;
+            *((uint16_t *) (buff + 2)) = i;
+            *((uint16_t *) (buff + 4)) = count;
+            memcpy(buff + FRAGMENT_HEAD_LEN, data.constData() + offset, len);
+            encodeFrame(frames, FRAGMENT_FUN_CODE, id, buff, FRAGMENT_HEAD_LEN + len);
+            ends.push_back(frames.size());
+        }
+    }
+    if (!enqueue(frames, ends)) {
+        logger.warn("TX: fun=0x{:02X}, id=0x{:04X} dropped, queue full", fun_code, id);
+        return;
+    }
+    logger.debug("TX: fun=0x{:02X}, id=0x{:04X}, len={}, frames={}", fun_code, id, size, ends.size());
+    /* 同一轮事件循环内的多次发送合并成一次写入 */
+    if (!flushScheduled.exchange(true))
+        QMetaObject::invokeMethod(this, "flushTxQueue", Qt::QueuedConnection);
+}
+
+void VCOMCOMM::receiveFragment(uint16_t id, const uint8_t *data, uint16_t len) {
+    if (len < FRAGMENT_HEAD_LEN) {
+        QMutexLocker lk(&fragStatMutex);
+        fragStat.invalidFragments++;
+        logger.warn("RX: id=0x{:04X} fragment too short, len={}", id, len);
         return;
     }
+    uint8_t fun_code = data[0], seq = data[1];
+    uint16_t index = *((const uint16_t *) (data + 2));
+    uint16_t count = *((const uint16_t *) (data + 4));
+    uint16_t chunk = len - FRAGMENT_HEAD_LEN;
+    if (count == 0 || index >= count || (size_t) count * FRAGMENT_PAYLOAD > MAX_MESSAGE_SIZE + FRAGMENT_PAYLOAD - 1 ||
+        (index + 1 < count && chunk != FRAGMENT_PAYLOAD)) {
+        QMutexLocker lk(&fragStatMutex);
+        fragStat.invalidFragments++;
+        logger.warn("RX: id=0x{:04X} invalid fragment {}/{}, len={}", id, index, count, len);
+        return;
+    }
+    {
+        QMutexLocker lk(&fragStatMutex);
+        fragStat.receivedFragments++;
+    }
 
-    logger.debug("TX: fun=0x{:02X}, id=0x{:04X}", fun_code, id);
+    qint64 now = txClock.nsecsElapsed();
+    uint32_t key = ((uint32_t) fun_code << 16) | id;
+    auto it = reassembly.find(key);
+    if (it != reassembly.end() && (it->second.seq != seq || it->second.count != count)) {
+        /* 新消息开始，上一条缺少分片无法完成 */
+        {
+            QMutexLocker lk(&fragStatMutex);
+            fragStat.droppedMessages++;
+        }
+        logger.warn("RX: fun=0x{:02X}, id=0x{:04X} message {} incomplete, {}/{} fragments",
+                    fun_code, id, it->second.seq, it->second.received, it->second.count);
+        reassembly.erase(it);
+        it = reassembly.end();
+    }
+    if (it == reassembly.end()) {
+        evictReassembly(now);
+        Reassembly r;
+        r.seq = seq;
+        r.count = count;
+        r.received = 0;
+        r.lastLen = 0;
+        r.got.assign(count, false);
+        r.data.resize(count * FRAGMENT_PAYLOAD);
+        it = reassembly.emplace(key, std::move(r)).first;
+    }
+    Reassembly &r = it->second;
+    r.lastTime = now;
+    if (r.got[index])
+        return;
+    r.got[index] = true;
+    r.received++;
+    memcpy(r.data.data() + index * FRAGMENT_PAYLOAD, data + FRAGMENT_HEAD_LEN, chunk);
+    if (index + 1 == count)
+        r.lastLen = chunk;
+    if (r.received != r.count)
+        return;
+
+    QByteArray message = r.data.left((count - 1) * FRAGMENT_PAYLOAD + r.lastLen);
+    reassembly.erase(it);
+    {
+        QMutexLocker lk(&fragStatMutex);
+        fragStat.receivedMessages++;
+    }
+    logger.debug("RX: fun=0x{:02X}, id=0x{:04X}, len={}, fragments={}", fun_code, id, message.size(), count);
+    if (!dispatch(fun_code, id, (const uint8_t *) message.constData(), message.size()))
+        emit receiveData(fun_code, id, message);
+}
+
+void VCOMCOMM::evictReassembly(qint64 now) {
+    uint64_t evicted = 0;
+    auto oldest = reassembly.end();
+    for (auto it = reassembly.begin(); it != reassembly.end();) {
+        if (now - it->second.lastTime > REASSEMBLY_TIMEOUT * 1000000LL) {
+            logger.warn("RX: fun=0x{:02X}, id=0x{:04X} message {} timeout, {}/{} fragments",
+                        it->first >> 16, it->first & 0xffff, it->second.seq, it->second.received, it->second.count);
+            it = reassembly.erase(it);
+            evicted++;
+            continue;
+        }
+        if (oldest == reassembly.end() || it->second.lastTime < oldest->second.lastTime)
+            oldest = it;
+        ++it;
+    }
+    if (reassembly.size() >= MAX_REASSEMBLY) {
+        logger.warn("RX: fun=0x{:02X}, id=0x{:04X} message {} evicted, too many messages in reassembly",
+                    oldest->first >> 16, oldest->first & 0xffff, oldest->second.seq);
+        reassembly.erase(oldest);
+        evicted++;
+    }
+    if (evicted > 0) {
+        QMutexLocker lk(&fragStatMutex);
+        fragStat.evictedMessages += evicted;
+    }
+}
+
+void VCOMCOMM::setFragmentation(bool enable) {
+    fragmentation = enable;
+    logger.info("fragmentation {}", enable ? "on" : "off");
+}
+
+VCOMCOMM::FragmentStatistics VCOMCOMM::fragmentStatistics() {
+    QMutexLocker lk(&fragStatMutex);
+    return fragStat;
+}
+
+void VCOMCOMM::flushTxQueue() {
+    flushScheduled = false;
     /* 忽略读写错误 */
     SerialPortError port_err = this->error();
     if (port_err == ReadError || port_err == WriteError)
         port_err = NoError;
-    if (!(this->isOpen() && port_err == NoError) && !this->auto_connect()) {
-        logger.error("Transmit Error, Port is closed or error");
+    /* 串口断开时数据留在发送队列中，由后台重连成功后发出 */
+    if (!this->isOpen())
+        return;
+    if (port_err != NoError) {
+        logger.error("Transmit Error, Port error");
+        portLost();
         return;
     }
-    if (data.size() > 64 - 8) {
-        logger.error("VCOMCOMM out of range len={}", data.size());
-        throw std::runtime_error("VCOMCOMM out of range");
+    QByteArray data;
+    uint64_t handedEnd;
+    {
+        QMutexLocker lk(&txMutex);
+        data.swap(txQueue);
+        handedEnd = txEnqueuedBytes;
+    }
+    if (data.isEmpty())
+        return;
+    qint64 written = this->write(data);
+    if (written != data.size()) {
+        /* 写失败的数据不会再触发bytesWritten，必须从统计中剔除，否则队列字节数只增不减 */
+        uint64_t dropped = data.size() - std::max<qint64>(written, 0);
+        logger.error("Transmit Error, write {} bytes failed", dropped);
+        dropUnwritten(handedEnd, dropped);
+    }
+}
+
+void VCOMCOMM::portBytesWritten(qint64 bytes) {
+    QMutexLocker lk(&txMutex);
+    txWrittenBytes += bytes;
+    qint64 now = txClock.nsecsElapsed();
+    while (!txMarks.empty() && txMarks.front().end <= txWrittenBytes) {
+        double latency = (now - txMarks.front().time) / 1e6;
+        txStat.writeLatency = txStat.writeLatency == 0 ? latency : txStat.writeLatency * 0.875 + latency * 0.125;
+        if (latency > txStat.maxWriteLatency)
+            txStat.maxWriteLatency = latency;
+        txMarks.pop_front();
     }
-    uint8_t len = (uint8_t) data.size();
-    uint8_t buff[64] = {0x5a, fun_code};
-    *((uint16_t *) (buff + 2)) = id;
-    *((uint16_t *) (buff + 4)) = len;
-    memcpy(buff + 6, data.data(), len);
-    *((uint16_t *) (buff + 6 + len)) = (len == 0) ? 0 : CRC::Verify_CRC16_Check_Sum(data);
-    this->writeData((const char *) buff, len + 8);
-    this->waitForBytesWritten(100);
-    this->clear(Output);
+}
+
+void VCOMCOMM::discardWriteBuffer() {
+    QMutexLocker lk(&txMutex);
+    /* 已交给串口但没有写出的数据随关闭丢失，只保留发送队列中的 */
+    txWrittenBytes = txEnqueuedBytes - txQueue.size();
+    while (!txMarks.empty() && txMarks.front().end <= txWrittenBytes)
+        txMarks.pop_front();
+}
+
+void VCOMCOMM::dropUnwritten(uint64_t handedEnd, uint64_t bytes) {
+    QMutexLocker lk(&txMutex);
+    uint64_t dropBegin = handedEnd - bytes;
+    /* 结束位置落在失败区间内的帧没有完整写出，之后入队的帧整体前移 */
+    for (auto it = txMarks.begin(); it != txMarks.end();) {
+        if (it->end > handedEnd) {
+            it->end -= bytes;
+            ++it;
+        } else if (it->end > dropBegin) {
+            txStat.droppedFrames++;
+            it = txMarks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    txEnqueuedBytes -= bytes;
+}
+
+VCOMCOMM::TxStatistics VCOMCOMM::txStatistics() {
+    QMutexLocker lk(&txMutex);
+    TxStatistics stat = txStat;
+    stat.queueFrames = txMarks.size();
+    stat.queueBytes = txEnqueuedBytes - txWrittenBytes;
+    return stat;
+}
+
+void VCOMCOMM::setTxQueueLimit(size_t bytes) {
+    QMutexLocker lk(&txMutex);
+    txQueueLimit = bytes;
 }
 
 void VCOMCOMM::setPidVid(uint16_t PID, uint16_t VID) {
@@ -124,3 +455,89 @@ void VCOMCOMM::setPidVid(uint16_t PID, uint16_t VID) {
 void VCOMCOMM::setManufacturer(const QString &manufacturer) {
     VCOMCOMM::manufacturer = manufacturer;
 }
+
+bool VCOMCOMM::startReaderThread(size_t ringCapacity, int priority, int cpu) {
+    if (readerThread != nullptr)
+        return true;
+    if (this->parent() != nullptr || this->thread() != QThread::currentThread()) {
+        logger.error("reader thread needs an object without parent, started from its own thread");
+        return false;
+    }
+    rxRing.reset(new SPSCRing<RxFrame>(ringCapacity));
+    ringDropped = 0;
+    ringMode = true;
+    readerThread = new QThread;
+    readerThread->setObjectName("VCOMCOMM");
+    /* started在新线程内发出，直接连接即可在读线程内设置调度参数 */
+    connect(readerThread, &QThread::started, [this, priority, cpu]() { setupReaderThread(priority, cpu); });
+    this->moveToThread(readerThread);
+    readerThread->start();
+    logger.info("reader thread started, ring capacity {}", rxRing->capacity());
+    return true;
+}
+
+void VCOMCOMM::stopReaderThread() {
+    if (readerThread == nullptr)
+        return;
+    if (QThread::currentThread() == readerThread) {
+        logger.error("can't stop reader thread from itself");
+        return;
+    }
+    QThread *owner = QThread::currentThread();
+    QMetaObject::invokeMethod(this, [this, owner]() {
+        ringMode = false;
+        this->moveToThread(owner);
+    }, Qt::BlockingQueuedConnection);
+    readerThread->quit();
+    readerThread->wait();
+    delete readerThread;
+    readerThread = nullptr;
+    logger.info("reader thread stopped");
+}
+
+void VCOMCOMM::setupReaderThread(int priority, int cpu) {
+#ifdef __linux__
+    if (priority > 0) {
+        sched_param param = {};
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+            logger.warn("can't set SCHED_FIFO priority {}: {}", priority, strerror(err));
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0)
+            logger.warn("can't set affinity to cpu {}: {}", cpu, strerror(err));
+    }
+#else
+    if (priority > 0 || cpu >= 0)
+        logger.warn("real-time scheduling and affinity are only supported on linux");
+#endif
+}
+
+void VCOMCOMM::registerHandler(uint8_t fun_code, uint16_t id, const FrameHandler &handler) {
+    if (!handler) {
+        unregisterHandler(fun_code, id);
+        return;
+    }
+    auto &table = handlers[fun_code];
+    if (!table)
+        table.reset(new std::array<std::unique_ptr<HandlerPage>, 256>());
+    auto &page = (*table)[id >> 8];
+    if (!page)
+        page.reset(new HandlerPage());
+    (*page)[id & 0xff] = handler;
+}
+
+void VCOMCOMM::unregisterHandler(uint8_t fun_code, uint16_t id) {
+    const auto &table = handlers[fun_code];
+    if (!table)
+        return;
+    const auto &page = (*table)[id >> 8];
+    if (!page)
+        return;
+    (*page)[id & 0xff] = nullptr;
+}
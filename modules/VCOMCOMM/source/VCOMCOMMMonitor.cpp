@@ -0,0 +1,75 @@
+/**
+ * @file VCOMCOMMMonitor.cpp
+ */
+
+#include "VCOMCOMMMonitor.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#endif
+
+VCOMCOMMMonitor::VCOMCOMMMonitor(QObject *parent) : QObject(parent), logger(__FUNCTION__) {
+#ifdef __linux__
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        logger.warn("can't create uevent socket: {}", strerror(errno));
+        return;
+    }
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;
+    addr.nl_groups = 1;     // 内核广播组，消息为纯文本，不依赖libudev
+    if (bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        logger.warn("can't bind uevent socket: {}", strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &VCOMCOMMMonitor::socketActivated);
+#endif
+}
+
+VCOMCOMMMonitor::~VCOMCOMMMonitor() {
+#ifdef __linux__
+    if (fd >= 0) {
+        delete notifier;
+        ::close(fd);
+    }
+#endif
+}
+
+void VCOMCOMMMonitor::socketActivated() {
+#ifdef __linux__
+    char buff[8192];
+    ssize_t len;
+    while ((len = recv(fd, buff, sizeof(buff) - 1, 0)) > 0) {
+        buff[len] = '\0';
+        /* 格式: ACTION@DEVPATH\0KEY=VALUE\0KEY=VALUE\0... */
+        QByteArray action, subsystem, devName;
+        for (const char *p = buff + strlen(buff) + 1; p < buff + len; p += strlen(p) + 1) {
+            if (strncmp(p, "ACTION=", 7) == 0)
+                action = p + 7;
+            else if (strncmp(p, "SUBSYSTEM=", 10) == 0)
+                subsystem = p + 10;
+            else if (strncmp(p, "DEVNAME=", 8) == 0)
+                devName = p + 8;
+        }
+        if (subsystem != "tty" || devName.isEmpty())
+            continue;
+        /* DEVNAME可能带有目录 */
+        devName = devName.mid(devName.lastIndexOf('/') + 1);
+        if (action == "add") {
+            logger.info("device '{}' added", devName.constData());
+            emit deviceAdded(QString::fromLocal8Bit(devName));
+        } else if (action == "remove") {
+            logger.info("device '{}' removed", devName.constData());
+            emit deviceRemoved(QString::fromLocal8Bit(devName));
+        }
+    }
+#endif
+}
@@ -0,0 +1,59 @@
+/**
+ * @file VCOMCOMMParser.cpp
+ */
+
+#include "VCOMCOMMParser.h"
+
+#include <string.h>
+#include "CRC.h"
+
+void VCOMCOMMParser::push(const uint8_t *data, size_t len) {
+    /* 已解析的数据在这里统一移除，避免每帧搬移 */
+    if (pos != 0) {
+        buffer.erase(buffer.begin(), buffer.begin() + pos);
+        pos = 0;
+    }
+    buffer.insert(buffer.end(), data, data + len);
+}
+
+bool VCOMCOMMParser::next(Frame &frame) {
+    while (pos < buffer.size()) {
+        const uint8_t *begin = buffer.data() + pos;
+        size_t remain = buffer.size() - pos;
+        if (*begin != SOF) {
+            const uint8_t *sof = (const uint8_t *) memchr(begin, SOF, remain);
+            size_t skip = sof ? sof - begin : remain;
+            stat.droppedBytes += skip;
+            pos += skip;
+            continue;
+        }
+        if (remain < HEAD_LEN)
+            return false;
+        uint16_t len;
+        memcpy(&len, begin + 4, sizeof(uint16_t));
+        if (len > maxPayload) {
+            stat.droppedBytes++;
+            pos++;
+            continue;
+        }
+        if (remain < len + FRAME_OVERHEAD)
+            return false;
+        uint16_t crc;
+        memcpy(&crc, begin + HEAD_LEN + len, sizeof(uint16_t));
+        /* 空数据包不校验 */
+        if (len != 0 && crc != CRC::Verify_CRC16_Check_Sum((uint8_t *) begin + HEAD_LEN, len)) {
+            stat.crcErrors++;
+            stat.droppedBytes++;
+            pos++;
+            continue;
+        }
+        frame.fun_code = begin[1];
+        memcpy(&frame.id, begin + 2, sizeof(uint16_t));
+        frame.len = len;
+        frame.data = begin + HEAD_LEN;
+        pos += len + FRAME_OVERHEAD;
+        stat.frames++;
+        return true;
+    }
+    return false;
+}